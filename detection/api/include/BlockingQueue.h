@@ -28,10 +28,17 @@
 #ifndef BLOCKING_QUEUE_H
 #define BLOCKING_QUEUE_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <iterator>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <stdexcept>
+#include <vector>
 
 
 namespace MPF { namespace COMPONENT {
@@ -46,6 +53,11 @@ public:
 };
 
 
+/**
+ * Bounded multi-producer/multi-consumer queue. Producers wait on not_full_ and consumers wait
+ * on not_empty_. Adding or removing an item only wakes a single waiting thread on the other
+ * side instead of every waiting producer and consumer.
+ */
 template <typename T>
 class BlockingQueue {
 
@@ -54,6 +66,9 @@ public:
             : max_size_(max_size)
             , halt_(false)
             , adding_complete_(false)
+            , size_(0)
+            , num_waiting_consumers_(0)
+            , num_waiting_producers_(0)
     {
     }
 
@@ -62,10 +77,7 @@ public:
      * @param item object to be copied in to queue
      */
     void push(const T& item) {
-        auto lock = acquire_lock();
-        wait_until_can_add(lock);
-        queue_.push(item);
-        cond_.notify_all();
+        emplace(item);
     }
 
     /**
@@ -73,10 +85,7 @@ public:
      * @param item object to be moved in to queue
      */
     void push(T&& item) {
-        auto lock = acquire_lock();
-        wait_until_can_add(lock);
-        queue_.push(std::move(item));
-        cond_.notify_all();
+        emplace(std::move(item));
     }
 
     /**
@@ -85,10 +94,43 @@ public:
      */
     template <typename... Args>
     void emplace(Args&&... args) {
-        auto lock = acquire_lock();
-        wait_until_can_add(lock);
-        queue_.emplace(std::forward<Args>(args)...);
-        cond_.notify_all();
+        int num_to_wake;
+        {
+            auto lock = acquire_lock();
+            wait_until_can_add(lock);
+            queue_.emplace(std::forward<Args>(args)...);
+            update_size();
+            num_to_wake = std::min(1, num_waiting_consumers_);
+        }
+        notify(not_empty_, num_to_wake);
+    }
+
+    /**
+     * Moves the items in [first, last) in to the queue in order. Blocks while the queue is full.
+     * As many items as will fit are added each time the lock is acquired. If the queue is halted
+     * or completed before all of the items are added, the items that were already added remain
+     * in the queue and QueueHaltedException is thrown.
+     * @param first Iterator to the first item to add
+     * @param last Iterator one past the last item to add
+     */
+    template <typename InputIt>
+    void push_range(InputIt first, InputIt last) {
+        while (first != last) {
+            int num_added = 0;
+            int num_to_wake;
+            {
+                auto lock = acquire_lock();
+                wait_until_can_add(lock);
+                while (first != last && has_space()) {
+                    queue_.push(std::move(*first));
+                    ++first;
+                    num_added++;
+                }
+                update_size();
+                num_to_wake = std::min(num_added, num_waiting_consumers_);
+            }
+            notify(not_empty_, num_to_wake);
+        }
     }
 
 
@@ -97,23 +139,104 @@ public:
      * @return The object from the front of the queue
      */
     T pop() {
-        auto lock = acquire_lock();
-        wait_until_can_remove(lock);
-        T result = std::move(queue_.front());
-        queue_.pop();
-        cond_.notify_all();
+        std::optional<T> result;
+        int num_to_wake;
+        {
+            auto lock = acquire_lock();
+            wait_until_can_remove(lock);
+            result.emplace(remove_front());
+            num_to_wake = std::min(1, num_waiting_producers_);
+        }
+        notify(not_full_, num_to_wake);
+        return std::move(*result);
+    }
+
+    /**
+     * Moves an item out of the queue and returns it. Blocks until an item is available or until
+     * timeout has elapsed.
+     * @param timeout Maximum amount of time to wait for an item
+     * @return The object from the front of the queue or an empty optional if the timeout elapsed
+     */
+    template <typename Rep, typename Period>
+    std::optional<T> try_pop(const std::chrono::duration<Rep, Period> &timeout) {
+        std::optional<T> result;
+        int num_to_wake;
+        {
+            auto lock = acquire_lock();
+            num_waiting_consumers_++;
+            bool ready = not_empty_.wait_for(lock, timeout, [this] { return can_remove(); });
+            num_waiting_consumers_--;
+            if (!ready) {
+                return result;
+            }
+            throw_if_cannot_remove();
+            result.emplace(remove_front());
+            num_to_wake = std::min(1, num_waiting_producers_);
+        }
+        notify(not_full_, num_to_wake);
         return result;
     }
 
+    /**
+     * Moves up to max_items items out of the queue and appends them to items. Only blocks if the
+     * queue is empty. All of the items are removed while holding the lock once.
+     * @param items[out] Vector the removed items will be appended to
+     * @param max_items Maximum number of items to remove
+     * @return The number of items that were removed
+     */
+    int pop_many(std::vector<T> &items, int max_items) {
+        int num_removed = 0;
+        int num_to_wake;
+        {
+            auto lock = acquire_lock();
+            wait_until_can_remove(lock);
+            while (num_removed < max_items && !queue_.empty()) {
+                items.push_back(std::move(queue_.front()));
+                queue_.pop();
+                num_removed++;
+            }
+            update_size();
+            num_to_wake = std::min(num_removed, num_waiting_producers_);
+        }
+        notify(not_full_, num_to_wake);
+        return num_removed;
+    }
+
+    /**
+     * Changes the maximum number of items the queue may hold. When the queue currently has more
+     * items than the new maximum, no items are removed, but producers will block until enough
+     * items have been removed.
+     * @param max_size The new maximum size. Values less than 1 make the queue unbounded.
+     */
+    void set_max_size(int max_size) {
+        {
+            auto lock = acquire_lock();
+            max_size_ = max_size;
+        }
+        not_full_.notify_all();
+    }
+
+    /**
+     * Gets the number of items in the queue without acquiring the lock. The result may already
+     * be out of date when it is returned, so it should only be used for monitoring.
+     * @return The number of items in the queue
+     */
+    std::size_t size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
     /**
      * Indicates that both producers and consumers should stop processing even if there are items
      * in the queue. Any future adds or removes will cause a QueueHaltedException to be thrown.
      * This can be used to prevent one side from blocking indefinitely when the other side fails.
      */
     void halt() {
-        auto lock = acquire_lock();
-        halt_ = true;
-        cond_.notify_all();
+        {
+            auto lock = acquire_lock();
+            halt_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
     }
 
     /**
@@ -126,9 +249,12 @@ public:
      * (https://docs.microsoft.com/en-us/dotnet/api/system.collections.concurrent.blockingcollection-1.completeadding?view=net-5.0#System_Collections_Concurrent_BlockingCollection_1_CompleteAdding).
      */
     void complete_adding() {
-        auto lock = acquire_lock();
-        adding_complete_ = true;
-        cond_.notify_all();
+        {
+            auto lock = acquire_lock();
+            adding_complete_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
     }
 
     /**
@@ -154,32 +280,75 @@ private:
     int max_size_;
     std::queue<T> queue_;
     std::mutex mutex_;
-    std::condition_variable cond_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
     bool halt_;
     bool adding_complete_;
+    std::atomic<std::size_t> size_;
+    int num_waiting_consumers_;
+    int num_waiting_producers_;
 
 
     void wait_until_can_remove(std::unique_lock<std::mutex> &lock) {
-        cond_.wait(lock, [this] { return halt_ || adding_complete_ || !queue_.empty(); });
+        if (!can_remove()) {
+            num_waiting_consumers_++;
+            not_empty_.wait(lock, [this] { return can_remove(); });
+            num_waiting_consumers_--;
+        }
+        throw_if_cannot_remove();
+    }
+
+    void throw_if_cannot_remove() {
         if (halt_ || (queue_.empty() && adding_complete_)) {
             throw QueueHaltedException();
         }
     }
 
     void wait_until_can_add(std::unique_lock<std::mutex> &lock) {
-        if (max_size_ > 0) {
-            cond_.wait(lock, [this] {
-                return halt_ || adding_complete_ || queue_.size() < max_size_;
-            });
+        if (!can_add()) {
+            num_waiting_producers_++;
+            not_full_.wait(lock, [this] { return can_add(); });
+            num_waiting_producers_--;
         }
         if (halt_ || adding_complete_) {
             throw QueueHaltedException();
         }
     }
 
+    bool can_remove() const {
+        return halt_ || adding_complete_ || !queue_.empty();
+    }
+
+    bool can_add() const {
+        return halt_ || adding_complete_ || has_space();
+    }
+
+    bool has_space() const {
+        return max_size_ <= 0 || queue_.size() < static_cast<std::size_t>(max_size_);
+    }
+
+    T remove_front() {
+        T result = std::move(queue_.front());
+        queue_.pop();
+        update_size();
+        return result;
+    }
+
+    void update_size() {
+        size_.store(queue_.size(), std::memory_order_relaxed);
+    }
+
     std::unique_lock<std::mutex> acquire_lock() {
         return std::unique_lock<std::mutex>(mutex_);
     }
+
+    // Wakes one waiting thread per item added or removed. num_to_wake is capped at the number of
+    // threads that were waiting, so no system call is made when nothing is waiting.
+    static void notify(std::condition_variable &cond, int num_to_wake) {
+        for (int i = 0; i < num_to_wake; i++) {
+            cond.notify_one();
+        }
+    }
 };
 }}
 
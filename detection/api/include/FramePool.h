@@ -0,0 +1,124 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_FRAMEPOOL_H
+#define OPENMPF_CPP_COMPONENT_SDK_FRAMEPOOL_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * A cv::MatAllocator that recycles frame buffers instead of freeing them. When a cv::Mat's
+     * allocator field is set to a FramePool, the buffers created by cv::Mat::create, including
+     * the ones created by cv::VideoCapture::read and cv::warpAffine, come from the pool.
+     * A buffer is returned to the pool when the last cv::Mat referring to it is released.
+     * Buffers are page-aligned.
+     *
+     * The pool must outlive every cv::Mat that uses it, so MPFVideoCapture uses the
+     * process-wide instance returned by GetInstance.
+     */
+    class FramePool : public cv::MatAllocator {
+    public:
+        struct Stats {
+            // Number of buffers that were allocated from the system.
+            long allocationCount = 0;
+            // Number of buffers that were requested from the pool.
+            long requestCount = 0;
+            // Number of requests that were satisfied by a recycled buffer.
+            long hitCount = 0;
+            // Number of bytes held by idle buffers waiting to be reused.
+            std::size_t idleBytes = 0;
+
+            double GetHitRate() const;
+        };
+
+        /**
+         * @param maxIdleBytes When returning a buffer to the pool would make the total size of the
+         *                     idle buffers exceed maxIdleBytes, the buffer is freed instead.
+         */
+        explicit FramePool(std::size_t maxIdleBytes = DEFAULT_MAX_IDLE_BYTES);
+
+        ~FramePool() override;
+
+        FramePool(const FramePool&) = delete;
+        FramePool& operator=(const FramePool&) = delete;
+
+        /**
+         * @return The process-wide pool. It is never destroyed, so frames may safely outlive
+         *         the objects that created them.
+         */
+        static FramePool& GetInstance();
+
+        /**
+         * Makes future allocations for mat come from this pool.
+         * @param mat[in,out]
+         */
+        void Use(cv::Mat &mat);
+
+        Stats GetStats() const;
+
+        /**
+         * Frees all of the idle buffers.
+         */
+        void Clear();
+
+
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                               cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+
+        bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags,
+                      cv::UMatUsageFlags usageFlags) const override;
+
+        void deallocate(cv::UMatData* data) const override;
+
+
+        static constexpr std::size_t DEFAULT_MAX_IDLE_BYTES = 512 * 1024 * 1024;
+
+    private:
+        const std::size_t maxIdleBytes_;
+
+        // cv::MatAllocator's methods are const, but the pool needs to be modified when
+        // allocating and deallocating.
+        mutable std::mutex mutex_;
+
+        // Maps buffer size to idle buffers of that size.
+        mutable std::multimap<std::size_t, void*> idleBuffers_;
+
+        mutable Stats stats_;
+
+        void* AcquireBuffer(std::size_t size) const;
+
+        void ReleaseBuffer(void* buffer, std::size_t size) const;
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_FRAMEPOOL_H
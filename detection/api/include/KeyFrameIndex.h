@@ -0,0 +1,94 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_KEYFRAMEINDEX_H
+#define OPENMPF_CPP_COMPONENT_SDK_KEYFRAMEINDEX_H
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * Finds the key frames in a video using the packet flags from the container, so the video
+     * does not need to be decoded. The platform splits a video in to many segment jobs, so the
+     * index is kept in memory for the other jobs in the process and, when the directory is
+     * writable, saved next to the video for the jobs in other processes. Cached indexes are only
+     * used when the video's size and modification time have not changed. When several captures
+     * in the same process need the same video's index at the same time, only one of them runs
+     * ffprobe.
+     */
+    class KeyFrameIndex {
+    public:
+        struct KeyFrames {
+            // Frame numbers of every key frame in the video, in increasing order
+            std::vector<int> frameNumbers;
+            // Presentation time of each key frame in milliseconds, relative to the first frame
+            std::vector<double> timesInMillis;
+        };
+
+        /**
+         * @param videoPath Path to the video
+         * @param useDiskCache Whether to read and write the index file next to the video
+         * @return Frame numbers of every key frame in the video, in increasing order
+         * @throws std::runtime_error When ffprobe fails
+         */
+        static std::shared_ptr<const std::vector<int>> Get(const std::string &videoPath,
+                                                           bool useDiskCache = true);
+
+        /**
+         * Same as Get, but also includes the presentation time of each key frame so that
+         * seeks to a key frame can be verified on variable frame rate videos.
+         */
+        static std::shared_ptr<const KeyFrames> GetWithTimes(const std::string &videoPath,
+                                                             bool useDiskCache = true);
+
+        /**
+         * @return Path of the file used to save the index for videoPath
+         */
+        static std::string GetCachePath(const std::string &videoPath);
+
+        /**
+         * Removes every index from the in-memory cache.
+         */
+        static void ClearMemoryCache();
+
+        /**
+         * Builds the index from the CSV output of
+         * "ffprobe -show_entries packet=pts_time,dts_time,flags -print_format csv=p=0".
+         * Packets flagged as discard are not counted as frames.
+         */
+        static KeyFrames ParsePackets(std::istream &ffprobeOutput);
+
+    private:
+        static KeyFrames ReadFromContainer(const std::string &videoPath);
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_KEYFRAMEINDEX_H
@@ -0,0 +1,252 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+
+#ifndef LOCK_FREE_SPSC_QUEUE_H
+#define LOCK_FREE_SPSC_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BlockingQueue.h"
+
+
+namespace MPF { namespace COMPONENT {
+
+
+/**
+ * Bounded queue for exactly one producer thread and one consumer thread. Adding and removing
+ * items does not require a lock. When a thread needs to wait, it spins briefly before parking on
+ * a condition variable. The condition variable is only notified when the other thread is parked.
+ * Supports the same halt() and complete_adding() semantics as BlockingQueue.
+ */
+template <typename T>
+class LockFreeSpscQueue {
+
+public:
+    explicit LockFreeSpscQueue(int max_size)
+            : capacity_(std::max(1, max_size))
+            , slots_(new std::optional<T>[capacity_])
+    {
+    }
+
+    LockFreeSpscQueue(const LockFreeSpscQueue&) = delete;
+    LockFreeSpscQueue& operator=(const LockFreeSpscQueue&) = delete;
+
+    /**
+     * Adds a copy of item to the queue. Blocks if queue is already full.
+     * Must only be called from the producer thread.
+     * @param item object to be copied in to queue
+     */
+    void push(const T& item) {
+        emplace(item);
+    }
+
+    /**
+     * Moves item in to the queue. Blocks if queue is already full.
+     * Must only be called from the producer thread.
+     * @param item object to be moved in to queue
+     */
+    void push(T&& item) {
+        emplace(std::move(item));
+    }
+
+    /**
+     * Constructs an instance of T in-place in the queue. Blocks if queue is already full.
+     * Must only be called from the producer thread.
+     * @param args Arguments to be passed to T's constructor
+     */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        wait_until([this, tail] {
+            return is_adding_complete() || tail - head_.load(std::memory_order_acquire) < capacity_;
+        });
+        if (is_adding_complete()) {
+            throw QueueHaltedException();
+        }
+        slots_[tail % capacity_].emplace(std::forward<Args>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        wake_parked_thread();
+    }
+
+
+    /**
+     * Moves an item out of the queue and returns it. Blocks if the queue is empty.
+     * Must only be called from the consumer thread.
+     * @return The object from the front of the queue
+     */
+    T pop() {
+        size_t head = wait_until_can_remove();
+        auto &slot = slots_[head % capacity_];
+        T result = std::move(*slot);
+        slot.reset();
+        head_.store(head + 1, std::memory_order_release);
+        wake_parked_thread();
+        return result;
+    }
+
+    /**
+     * Moves up to max_items items out of the queue and appends them to items. Only blocks if the
+     * queue is empty. Must only be called from the consumer thread.
+     * @param items[out] Vector the removed items will be appended to
+     * @param max_items Maximum number of items to remove
+     * @return The number of items that were removed
+     */
+    int pop_many(std::vector<T> &items, int max_items) {
+        size_t head = wait_until_can_remove();
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t num_to_remove = std::min(tail - head, static_cast<size_t>(std::max(0, max_items)));
+        for (size_t i = 0; i < num_to_remove; i++) {
+            auto &slot = slots_[(head + i) % capacity_];
+            items.push_back(std::move(*slot));
+            slot.reset();
+        }
+        head_.store(head + num_to_remove, std::memory_order_release);
+        wake_parked_thread();
+        return static_cast<int>(num_to_remove);
+    }
+
+    /**
+     * Indicates that both producers and consumers should stop processing even if there are items
+     * in the queue. Any future adds or removes will cause a QueueHaltedException to be thrown.
+     * This can be used to prevent one side from blocking indefinitely when the other side fails.
+     */
+    void halt() {
+        halt_.store(true);
+        wake_parked_thread();
+    }
+
+    /**
+     * Indicates that no more items will be added to the queue. Consumers should finish processing
+     * items already in the queue. Any attempt to add items after this is called will cause a
+     * QueueHaltedException to be thrown.
+     */
+    void complete_adding() {
+        adding_complete_.store(true);
+        wake_parked_thread();
+    }
+
+    /**
+     * @return true if adding complete. Queue may or may not be empty.
+     */
+    bool is_adding_complete() const {
+        return halt_.load() || adding_complete_.load();
+    }
+
+    /**
+     * The queue is "completed" if it has been halted or if a producer called complete_adding()
+     * and the remaining items have all been removed from the queue.
+     * @return true if items should not be added or removed from queue.
+     */
+    bool is_completed() const {
+        return halt_.load() || (adding_complete_.load() && is_empty());
+    }
+
+
+private:
+    // Number of times to check the condition before parking the thread.
+    static constexpr int SPIN_COUNT = 128;
+
+    // Number of spins after which the thread starts yielding between checks.
+    static constexpr int YIELD_AFTER = 64;
+
+    const size_t capacity_;
+
+    const std::unique_ptr<std::optional<T>[]> slots_;
+
+    // head_ and tail_ are only ever incremented. head_ is written by the consumer and tail_ is
+    // written by the producer. They are on separate cache lines to prevent false sharing.
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+
+    alignas(64) std::atomic<bool> halt_{false};
+    std::atomic<bool> adding_complete_{false};
+
+    std::atomic<int> num_parked_{0};
+    std::mutex park_mutex_;
+    std::condition_variable park_cond_;
+
+
+    bool is_empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t wait_until_can_remove() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        wait_until([this, head] {
+            return halt_.load() || adding_complete_.load()
+                    || tail_.load(std::memory_order_acquire) != head;
+        });
+        // complete_adding() is always called after the last item is added, so if adding_complete_
+        // is true, tail_ has its final value.
+        if (halt_.load() || (adding_complete_.load() && tail_.load(std::memory_order_acquire) == head)) {
+            throw QueueHaltedException();
+        }
+        return head;
+    }
+
+    template <typename Predicate>
+    void wait_until(Predicate predicate) {
+        for (int i = 0; i < SPIN_COUNT; i++) {
+            if (predicate()) {
+                return;
+            }
+            if (i >= YIELD_AFTER) {
+                std::this_thread::yield();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        num_parked_.fetch_add(1);
+        // Pairs with the fence in wake_parked_thread. Either this thread will see the other
+        // thread's change when checking the predicate or the other thread will see that this
+        // thread is parked and notify it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        park_cond_.wait(lock, predicate);
+        num_parked_.fetch_sub(1);
+    }
+
+    void wake_parked_thread() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (num_parked_.load() > 0) {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+            park_cond_.notify_all();
+        }
+    }
+};
+}}
+
+
+#endif
@@ -27,15 +27,20 @@
 #ifndef OPENMPF_CPP_COMPONENT_SDK_MPFASYNCVIDEOCAPTURE_H
 #define OPENMPF_CPP_COMPONENT_SDK_MPFASYNCVIDEOCAPTURE_H
 
+#include <atomic>
+#include <cstdint>
 #include <future>
 #include <optional>
 #include <string>
+#include <variant>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
 #include "MPFDetectionComponent.h"
 #include "MPFVideoCapture.h"
 #include "BlockingQueue.h"
+#include "LockFreeSpscQueue.h"
 
 namespace MPF::COMPONENT {
 
@@ -51,12 +56,43 @@ namespace MPF::COMPONENT {
     };
 
 
+    /**
+     * Frame queue measurements reported by MPFAsyncVideoCapture::GetFrameQueueMetrics.
+     */
+    struct FrameQueueMetrics {
+        // The current maximum number of frames in the frame queue.
+        int capacity;
+        // The largest capacity used so far.
+        int peakCapacity;
+        // Total time the frame reader spent waiting because the frame queue was full.
+        double producerStallSeconds;
+        // Total time Read and ReadBatch spent waiting because the frame queue was empty.
+        double consumerStallSeconds;
+    };
+
+
     /**
      * Reads frames from a regular MPFVideoCapture on a background thread. Frames are buffered
      * in a fixed sized BlockingQueue. This class intentionally exposes a subset of the
      * MPFVideoCapture functionality. Functionality that would impossible or difficult to write in
      * a thread-safe manner has been omitted. Frame transformers, frame filters, and feed forward
      * are all supported.
+     * When the USE_FRAME_POOL job property is true, the frames are read in to buffers from
+     * FramePool::GetInstance(). A frame's buffer is returned to the pool once the consumer
+     * releases the MPFFrame and every copy of its cv::Mat.
+     * When the USE_LOCK_FREE_FRAME_QUEUE job property is true, a LockFreeSpscQueue is used
+     * instead of a BlockingQueue. In that case, Read and ReadBatch must not be called
+     * concurrently from multiple threads.
+     * When the ADAPTIVE_FRAME_QUEUE_CAPACITY job property is true, FRAME_QUEUE_CAPACITY is only
+     * the initial capacity. The frame reader periodically compares how long it was blocked on a
+     * full queue with how long the consumer was blocked on an empty queue. The capacity grows
+     * when both sides stall and shrinks when only the frame reader stalls. The capacity never
+     * exceeds what fits in FRAME_QUEUE_MAX_BYTES (default: 512 MiB). Adaptive mode always uses a
+     * BlockingQueue since LockFreeSpscQueue has a fixed capacity.
+     * When the TRANSFORM_THREADS job property is greater than 0, one thread decodes the frames
+     * and that many threads apply the frame transformers in parallel. The frames are still
+     * returned in order. This helps when the frame transformers, such as rotation with
+     * INTER_CUBIC interpolation, take longer than decoding.
      */
     class MPFAsyncVideoCapture {
     public:
@@ -64,14 +100,33 @@ namespace MPF::COMPONENT {
                                       bool enableFrameTransformers=true,
                                       bool enableFrameFiltering=true);
 
-        explicit MPFAsyncVideoCapture(std::string videoPath, int frameQueueSize=4);
+        explicit MPFAsyncVideoCapture(std::string videoPath, int frameQueueSize=4,
+                                      bool useLockFreeQueue=false);
 
         ~MPFAsyncVideoCapture();
 
         std::optional<MPFFrame> Read();
 
+        /**
+         * Removes up to maxFrames frames from the frame queue while only acquiring the queue's
+         * lock once. Blocks until at least one frame is available.
+         * @param maxFrames Maximum number of frames to return
+         * @return Between 1 and maxFrames frames, or an empty vector when the end of the video
+         *         has been reached.
+         */
+        std::vector<MPFFrame> ReadBatch(int maxFrames);
+
         void ReverseTransform(MPFVideoTrack &videoTrack) const;
 
+        /**
+         * Reverse transforms a single detection, so that detections can be reported as soon as
+         * they are found instead of after the whole track is complete.
+         * @param imageLocation[in,out] The detection to reverse transform
+         * @param segmentFrameIndex Segment position of the frame in which the detection was found
+         * @return Position of the frame in the original video
+         */
+        int ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex) const;
+
         /**
          * @return An object that can do the reverse transform even after MPFAsyncVideoCapture has
          *         been destroyed
@@ -86,9 +141,37 @@ namespace MPF::COMPONENT {
 
         cv::Size GetOriginalFrameSize() const;
 
+        FrameQueueMetrics GetFrameQueueMetrics() const;
+
 
     private:
-        BlockingQueue<std::optional<MPFFrame>> frameQueue_;
+        using FrameQueue = std::variant<BlockingQueue<std::optional<MPFFrame>>,
+                                        LockFreeSpscQueue<std::optional<MPFFrame>>>;
+
+        struct FrameQueueConfig {
+            int capacity;
+            bool useLockFreeQueue;
+            // When greater than 0, the capacity is adjusted while reading and the queued frames
+            // are limited to this many bytes.
+            std::int64_t adaptiveMaxBytes;
+            // When greater than 0, frames are transformed on this many threads instead of on the
+            // frameReader thread.
+            int transformThreadCount;
+        };
+
+        // Shared with the frameReader thread.
+        struct FrameQueueStats {
+            std::atomic<int> capacity;
+            std::atomic<int> peakCapacity;
+            std::atomic<std::int64_t> producerStallNanos{0};
+            std::atomic<std::int64_t> consumerStallNanos{0};
+
+            explicit FrameQueueStats(int capacity);
+        };
+
+        FrameQueue frameQueue_;
+
+        FrameQueueStats frameQueueStats_;
 
         // Fields for properties of the video that don't change as it is being read.
         // We can't just query the underlying video capture on the fly because it is being used by
@@ -103,7 +186,19 @@ namespace MPF::COMPONENT {
 
         std::shared_future<void> doneReadingFuture_;
 
-        MPFAsyncVideoCapture(MPFVideoCapture&& videoCapture, int frameQueueSize);
+        MPFAsyncVideoCapture(MPFVideoCapture&& videoCapture, const MPFVideoJob &videoJob);
+
+        MPFAsyncVideoCapture(MPFVideoCapture&& videoCapture, const FrameQueueConfig &config);
+
+        static FrameQueueConfig GetFrameQueueConfig(const MPFVideoJob &videoJob,
+                                                    const cv::Size &frameSize);
+
+        static FrameQueue CreateFrameQueue(const FrameQueueConfig &config);
+
+        static std::shared_future<void> StartFrameReader(MPFVideoCapture &&videoCapture,
+                                                         FrameQueue &frameQueue,
+                                                         FrameQueueStats &stats,
+                                                         const FrameQueueConfig &config);
     };
 }
 
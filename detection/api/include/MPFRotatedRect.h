@@ -28,6 +28,9 @@
 #define OPENMPF_CPP_COMPONENT_SDK_MPFROTATEDRECT_H
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
@@ -64,6 +67,66 @@ namespace MPF { namespace COMPONENT {
 
     };
 
+
+
+    /**
+     * Stores many MPFRotatedRects in a structure of arrays layout, with the sine and cosine of
+     * each rotation computed once, so that the corners of all of the rectangles can be computed in
+     * simple loops instead of one matrix multiplication per rectangle.
+     */
+    class MPFRotatedRectBatch {
+
+    public:
+        MPFRotatedRectBatch() = default;
+
+        explicit MPFRotatedRectBatch(const std::vector<MPFRotatedRect> &rects);
+
+        void Add(const MPFRotatedRect &rect);
+
+        void Reserve(std::size_t count);
+
+        std::size_t Size() const;
+
+        bool Empty() const;
+
+        /**
+         * @return The corners of every rectangle. Corners 4 * i through 4 * i + 3 belong to the
+         *         i-th rectangle and are in the same order as MPFRotatedRect::GetCorners.
+         */
+        std::vector<cv::Point2d> GetCorners() const;
+
+        /**
+         * @return The same values as calling MPFRotatedRect::GetBoundingRect on each rectangle.
+         */
+        std::vector<cv::Rect2d> GetBoundingRects() const;
+
+        /**
+         * @return A rectangle that contains every rectangle in the batch.
+         */
+        cv::Rect2d GetBoundingRect() const;
+
+        /**
+         * Gets a rectangle that contains every rectangle in the batch after the corners are
+         * multiplied by linearTransform.
+         * @param linearTransform Transformation to apply to the corners, such as a rotation
+         *                        around the origin
+         */
+        cv::Rect2d GetMappedBoundingRect(const cv::Matx22d &linearTransform) const;
+
+    private:
+        std::vector<double> x_;
+        std::vector<double> y_;
+        std::vector<double> width_;
+        std::vector<double> height_;
+        std::vector<double> cos_;
+        std::vector<double> sin_;
+        // -1 when flipped, 1 otherwise.
+        std::vector<double> flipSign_;
+
+        template<typename CornerFunc>
+        void ForEachCorner(CornerFunc &&cornerFunc) const;
+    };
+
 }}
 
 
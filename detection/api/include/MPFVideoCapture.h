@@ -37,7 +37,10 @@
 
 #include "frame_transformers/IFrameTransformer.h"
 #include "FrameFilter.h"
+#include "FramePool.h"
 #include "MPFDetectionComponent.h"
+#include "SeekCostModel.h"
+#include "SeekStatistics.h"
 #include "SeekStrategy.h"
 
 
@@ -52,6 +55,27 @@ namespace MPF { namespace COMPONENT {
          * Initializes a new MPFVideoCapture instance, using the frame
          * transformers specified in jobProperties, to be used for video
          * processing jobs.
+         * The DECODE_THREADS job property can be used to set the number of threads the decoder
+         * uses. When set to 0, the decoder uses as many threads as there are CPU cores.
+         * When the USE_FRAME_POOL job property is true, frames are decoded and transformed in to
+         * buffers from FramePool::GetInstance().
+         * Seeks on variable frame rate videos, and on constant frame rate videos where setting the
+         * frame position fails, use the video's key frame index to start decoding from the closest
+         * key frame. Set the USE_INDEXED_SEEK job property to false to grab from the start of the
+         * video instead.
+         * When moving forward on constant frame rate videos, the time it takes to grab frames and
+         * to set the frame position is measured so that the faster one is used. Set the
+         * USE_SEEK_COST_MODEL job property to false to always grab when moving 16 or fewer frames.
+         * When FRAME_INTERVAL is greater than 1, the key frame index is used instead to decide,
+         * so that intervals longer than the distance between key frames only decode the frames
+         * from the key frame before each requested frame. Set the SPARSE_INTERVAL_DECODE job
+         * property to false to disable this.
+         * When the DECODE_MAX_DIMENSION job property is set and frame transformers are enabled,
+         * frames larger than it are shrunk as soon as they are decoded, so the other frame
+         * transformers only process the smaller frames. ReverseTransform scales detections back
+         * to the original frame coordinates.
+         * When the SEEK_STATISTICS_FILE job property is set, the seek statistics are appended to
+         * that file as a line of JSON when the capture is destroyed.
          * @param videoJob
          * @param enableFrameTransformers Automatically transform frames based on job properties
          * @param enableFrameFiltering Automatically skip frames based on job properties
@@ -65,6 +89,27 @@ namespace MPF { namespace COMPONENT {
 
         bool Read(cv::Mat &frame);
 
+        /**
+         * Reads the next frame without applying the frame transformers. The frame can be
+         * transformed later, possibly on another thread, by passing it and its segment position
+         * to the IFrameTransformer returned by GetFrameTransformer.
+         * @param frame[out]
+         * @return true if the frame was read
+         */
+        bool ReadWithoutTransform(cv::Mat &frame);
+
+        /**
+         * Reads up to maxFrames consecutive frames from the segment. The per-frame bookkeeping
+         * done by Read is only done once per batch and the frame transformers process the whole
+         * batch at once.
+         * @param frames[out] Replaced with the frames that were read. frames[i] is the frame at
+         *                    segment position (return value + i). Empty if no frames could be read.
+         *                    Like Read, the buffers of the cv::Mats already in frames may be reused.
+         * @param maxFrames Maximum number of frames to read
+         * @return The segment position of the first frame in frames or -1 if no frames were read
+         */
+        int ReadBatch(std::vector<cv::Mat> &frames, int maxFrames);
+
         MPFVideoCapture &operator>>(cv::Mat &frame);
 
         bool IsOpened() const;
@@ -75,6 +120,12 @@ namespace MPF { namespace COMPONENT {
 
         int GetCurrentFramePosition() const;
 
+        /**
+         * @return The strategy, frames decoded, and time of each seek, and the strategy fallbacks
+         *         that have happened so far
+         */
+        const SeekStatistics& GetSeekStatistics() const;
+
         /**
          * Release the underlying cv::VideoCapture. It is generally not necessary call this
          * manually, because the destructor will take care of it. This only needs to be called if
@@ -104,12 +155,33 @@ namespace MPF { namespace COMPONENT {
 
         void ReverseTransform(MPFVideoTrack &videoTrack) const;
 
+        /**
+         * Reverse transforms a single detection, so that detections can be reported as soon as
+         * they are found instead of after the whole track is complete.
+         * @param imageLocation[in,out] The detection to reverse transform
+         * @param segmentFrameIndex Segment position of the frame in which the detection was found
+         * @return Position of the frame in the original video
+         */
+        int ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex) const;
+
         /**
          * @return An object that can do the reverse transform even after MPFVideoCapture has been
          *         destroyed
          */
         ReverseTransformer GetReverseTransformer() const;
 
+        /**
+         * @return The frame filter used to map between segment frame positions and frame
+         *         positions in the original video
+         */
+        std::shared_ptr<const FrameFilter> GetFrameFilter() const;
+
+        /**
+         * @return The chain of frame transformers that Read applies to each frame. It is safe to
+         *         use from multiple threads at the same time.
+         */
+        std::shared_ptr<const IFrameTransformer> GetFrameTransformer() const;
+
         /**
          * Gets up to numberOfRequestedFrames frames before beginning of segment, skipping frameInterval frames.
          * If less than numberOfRequestedFrames are available, returned vector will have as many initialization frames
@@ -125,6 +197,12 @@ namespace MPF { namespace COMPONENT {
     private:
         std::string videoPath_;
 
+        /**
+         * Number of threads the FFmpeg decoder should use. Set from the DECODE_THREADS job
+         * property. A negative value means the property was not provided, so OpenCV's default is used.
+         */
+        int decodeThreadCount_;
+
         cv::VideoCapture cvVideoCapture_;
 
         std::shared_ptr<const FrameFilter> frameFilter_;
@@ -133,6 +211,11 @@ namespace MPF { namespace COMPONENT {
 
         SeekStrategy::CPtr seekStrategy_;
 
+        std::shared_ptr<SeekStatistics> seekStatistics_;
+
+        // nullptr when frames should not be allocated from a FramePool.
+        FramePool *framePool_;
+
         /**
          * MPFVideoCapture keeps track of the frame position instead of depending on
          * cv::VideoCapture::get(cv::VideoCaptureProperties::CAP_PROP_POS_FRAMES)
@@ -147,7 +230,13 @@ namespace MPF { namespace COMPONENT {
 
         IFrameTransformer::Ptr GetFrameTransformer(bool frameTransformersEnabled, const MPFVideoJob &job) const;
 
-        bool ReadAndTransform(cv::Mat &frame);
+        /**
+         * Reads the frame at the current position without transforming it, then moves to the
+         * next frame in the segment. Falls back to the next SeekStrategy if the read fails.
+         * @param frame[out]
+         * @return true if the frame was read
+         */
+        bool ReadAndMoveToNextFrame(cv::Mat &frame);
 
         void MoveToNextFrameInSegment();
 
@@ -170,7 +259,15 @@ namespace MPF { namespace COMPONENT {
 
         static SeekStrategy::CPtr GetSeekStrategy(const MPFVideoJob &job);
 
-        static cv::VideoCapture GetCvVideoCapture(const std::string &videoPath);
+        static std::shared_ptr<SeekCostModel> GetSeekCostModel(const MPFVideoJob &job);
+
+        static std::shared_ptr<SeekStatistics> CreateSeekStatistics(const MPFVideoJob &job);
+
+        static FramePool* GetFramePool(const MPFVideoJob &job);
+
+        static int GetDecodeThreadCount(const MPFVideoJob &job);
+
+        static cv::VideoCapture GetCvVideoCapture(const std::string &videoPath, int decodeThreadCount);
     };
 
 
@@ -182,10 +279,23 @@ namespace MPF { namespace COMPONENT {
 
         void operator()(MPFVideoTrack &track) const;
 
+        /**
+         * Reverse transforms a single detection, so that detections can be reported as soon as
+         * they are found instead of after the whole track is complete.
+         * @param imageLocation[in,out] The detection to reverse transform
+         * @param segmentFrameIndex Segment position of the frame in which the detection was found
+         * @return Position of the frame in the original video
+         */
+        int operator()(MPFImageLocation &imageLocation, int segmentFrameIndex) const;
+
         static void ReverseTransform(MPFVideoTrack &track,
                                      const IFrameTransformer& frameTransformer,
                                      const FrameFilter& frameFilter);
 
+        static int ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex,
+                                    const IFrameTransformer& frameTransformer,
+                                    const FrameFilter& frameFilter);
+
     private:
         std::shared_ptr<const IFrameTransformer> frameTransformer_;
         std::shared_ptr<const FrameFilter> frameFilter_;
@@ -0,0 +1,122 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_NONMAXIMUMSUPPRESSION_H
+#define OPENMPF_CPP_COMPONENT_SDK_NONMAXIMUMSUPPRESSION_H
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "MPFDetectionObjects.h"
+#include "MPFRotatedRect.h"
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * @return Area of the intersection divided by the area of the union, or 0 when the union is
+     *         empty.
+     */
+    double IntersectionOverUnion(const cv::Rect2d &rect1, const cv::Rect2d &rect2);
+
+    /**
+     * Rotated rectangles are treated as covering width by height pixels, so rectangles without
+     * rotation or flip get the same result as the cv::Rect2d overload.
+     * @return Area of the intersection divided by the area of the union, or 0 when the union is
+     *         empty.
+     */
+    double IntersectionOverUnion(const MPFRotatedRect &rect1, const MPFRotatedRect &rect2);
+
+    /**
+     * @return A rectangle with the detection's location and its ROTATION and HORIZONTAL_FLIP
+     *         properties.
+     */
+    MPFRotatedRect ToRotatedRect(const MPFImageLocation &imageLocation);
+
+
+    /**
+     * Greedily keeps the box with the highest score and drops the remaining boxes that overlap it
+     * by more than iouThreshold. Only boxes whose bounding rects are near each other are compared,
+     * so this does not compare every pair of boxes.
+     * @param boxes Boxes to filter
+     * @param scores Score of each box. scores[i] is the score for boxes[i].
+     * @param iouThreshold Boxes with an intersection over union greater than this are
+     *                     considered the same object.
+     * @return Indices of the boxes to keep, from highest to lowest score.
+     */
+    std::vector<int> NonMaximumSuppression(const std::vector<cv::Rect2d> &boxes,
+                                           const std::vector<float> &scores,
+                                           double iouThreshold);
+
+    std::vector<int> NonMaximumSuppression(const std::vector<MPFRotatedRect> &boxes,
+                                           const std::vector<float> &scores,
+                                           double iouThreshold);
+
+    /**
+     * Removes the detections that overlap a detection with a higher confidence by more than
+     * iouThreshold. The ROTATION and HORIZONTAL_FLIP properties are taken in to account. The
+     * remaining detections stay in their original order.
+     */
+    void NonMaximumSuppression(std::vector<MPFImageLocation> &detections, double iouThreshold);
+
+
+    enum class SoftNmsDecay {
+        // Multiply the score by (1 - IoU) when the IoU is greater than iouThreshold.
+        LINEAR,
+        // Multiply the score by exp(-IoU^2 / sigma).
+        GAUSSIAN
+    };
+
+    struct SoftNmsSettings {
+        SoftNmsDecay decay = SoftNmsDecay::GAUSSIAN;
+        // Only used with LINEAR decay.
+        double iouThreshold = 0.3;
+        // Only used with GAUSSIAN decay.
+        double sigma = 0.5;
+        // Boxes whose score decays below this are dropped.
+        double scoreThreshold = 0.001;
+    };
+
+    /**
+     * Instead of dropping the boxes that overlap a higher scoring box, their scores are reduced
+     * based on how much they overlap.
+     * @param boxes Boxes to filter
+     * @param scores[in,out] Score of each box. scores[i] is the score for boxes[i]. Replaced with
+     *                       the decayed scores.
+     * @param settings Decay function and thresholds
+     * @return Indices of the boxes to keep, from highest to lowest decayed score.
+     */
+    std::vector<int> SoftNonMaximumSuppression(const std::vector<cv::Rect2d> &boxes,
+                                               std::vector<float> &scores,
+                                               const SoftNmsSettings &settings = {});
+
+    std::vector<int> SoftNonMaximumSuppression(const std::vector<MPFRotatedRect> &boxes,
+                                               std::vector<float> &scores,
+                                               const SoftNmsSettings &settings = {});
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_NONMAXIMUMSUPPRESSION_H
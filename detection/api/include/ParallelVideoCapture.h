@@ -0,0 +1,140 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_PARALLELVIDEOCAPTURE_H
+#define OPENMPF_CPP_COMPONENT_SDK_PARALLELVIDEOCAPTURE_H
+
+#include <future>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "BlockingQueue.h"
+#include "FrameFilter.h"
+#include "MPFAsyncVideoCapture.h"
+#include "MPFDetectionComponent.h"
+#include "MPFVideoCapture.h"
+
+namespace MPF::COMPONENT {
+
+    /**
+     * Decodes a single video segment with multiple MPFVideoCapture instances running on
+     * background threads. The segment is split in to chunks that start on key frames when the
+     * key frames can be determined. The chunks are assigned to the decoders round-robin and
+     * Read returns the frames in their original order. Since each decoder is configured from
+     * the same job, frame transformers, frame filters, and feed forward are all supported and
+     * the frame indices and reverse transform match MPFVideoCapture.
+     *
+     * Each decoder buffers up to FRAME_QUEUE_CAPACITY frames, so it can get a head start on its
+     * next chunk while the consumer is reading another decoder's chunk.
+     * Seeking is only efficient when HAS_CONSTANT_FRAME_RATE is true. Otherwise each decoder
+     * must grab through the frames of the other decoders' chunks.
+     *
+     * Job properties:
+     *   PARALLEL_DECODER_COUNT: Number of decoders (default: min(4, number of CPU cores))
+     *   PARALLEL_CHUNK_SIZE: Minimum number of segment frames in a chunk (default: 64)
+     *   FRAME_QUEUE_CAPACITY: Maximum number of decoded frames buffered by each decoder (default: 4)
+     */
+    class ParallelVideoCapture {
+    public:
+        explicit ParallelVideoCapture(const MPFVideoJob &videoJob,
+                                      bool enableFrameTransformers=true,
+                                      bool enableFrameFiltering=true);
+
+        ~ParallelVideoCapture();
+
+        std::optional<MPFFrame> Read();
+
+        /**
+         * @return The segment position of the frame that the next call to Read will return.
+         */
+        int GetCurrentFramePosition() const;
+
+        void ReverseTransform(MPFVideoTrack &videoTrack) const;
+
+        /**
+         * Reverse transforms a single detection, so that detections can be reported as soon as
+         * they are found instead of after the whole track is complete.
+         * @param imageLocation[in,out] The detection to reverse transform
+         * @param segmentFrameIndex Segment position of the frame in which the detection was found
+         * @return Position of the frame in the original video
+         */
+        int ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex) const;
+
+        /**
+         * @return An object that can do the reverse transform even after ParallelVideoCapture
+         *         has been destroyed
+         */
+        ReverseTransformer GetReverseTransformer() const;
+
+        int GetFrameCount() const;
+
+        double GetFrameRate() const;
+
+        cv::Size GetFrameSize() const;
+
+        cv::Size GetOriginalFrameSize() const;
+
+        /**
+         * @return The first and last segment position of each chunk.
+         */
+        const std::vector<std::pair<int, int>>& GetChunks() const;
+
+
+    private:
+        struct Decoder {
+            std::unique_ptr<BlockingQueue<std::optional<MPFFrame>>> frameQueue;
+            std::shared_future<void> doneDecodingFuture;
+        };
+
+        int frameCount_;
+        double frameRate_;
+        cv::Size frameSize_;
+        cv::Size originalFrameSize_;
+
+        ReverseTransformer reverseTransformer_;
+
+        // Inclusive ranges of segment positions.
+        std::vector<std::pair<int, int>> chunks_;
+
+        std::vector<Decoder> decoders_;
+
+        size_t currentChunk_ = 0;
+
+        int framePosition_ = 0;
+
+        ParallelVideoCapture(const MPFVideoJob &videoJob, MPFVideoCapture &&firstDecoder,
+                             bool enableFrameTransformers, bool enableFrameFiltering);
+
+        static std::vector<std::pair<int, int>> CreateChunks(
+                const MPFVideoJob &videoJob, const FrameFilter &frameFilter, int chunkSize);
+    };
+}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_PARALLELVIDEOCAPTURE_H
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_REMAPTABLECACHE_H
+#define OPENMPF_CPP_COMPONENT_SDK_REMAPTABLECACHE_H
+
+#include <array>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * Caches the fixed-point maps that cv::remap uses to apply an affine transformation, so that
+     * the source coordinates of each output pixel only need to be computed once for all of the
+     * frames that use the same transformation. Entries are keyed by the output size and the
+     * reverse transformation matrix, so jobs in the same process with identical transformations
+     * share tables. The fill color and interpolation are passed to cv::remap, so they are not
+     * part of the key.
+     *
+     * When adding a table would make the cache exceed its byte limit, the least recently used
+     * tables are dropped. A dropped table stays alive until the last caller using it releases it.
+     */
+    class RemapTableCache {
+    public:
+        struct Tables {
+            // CV_16SC2 integer source coordinates.
+            cv::Mat map1;
+            // CV_16UC1 interpolation table indices for the fractional part of the coordinates.
+            cv::Mat map2;
+
+            std::size_t GetByteCount() const;
+        };
+
+        struct Stats {
+            // Number of tables currently in the cache.
+            std::size_t entryCount = 0;
+            // Number of bytes used by the tables currently in the cache.
+            std::size_t bytes = 0;
+            // Number of lookups that found an existing table.
+            long hitCount = 0;
+            // Number of lookups that had to build a table.
+            long missCount = 0;
+            // Number of tables dropped to stay under the byte limit.
+            long evictionCount = 0;
+        };
+
+        explicit RemapTableCache(std::size_t maxBytes = DEFAULT_MAX_BYTES);
+
+        RemapTableCache(const RemapTableCache&) = delete;
+        RemapTableCache& operator=(const RemapTableCache&) = delete;
+
+        /**
+         * @return The process-wide cache.
+         */
+        static RemapTableCache& GetInstance();
+
+        /**
+         * Gets the maps for an affine transformation, building them if they are not already
+         * cached.
+         * @param outputSize Size of the transformed frame
+         * @param reverseTransformationMatrix Maps output pixel coordinates to input pixel
+         *                                    coordinates, like cv::WARP_INVERSE_MAP
+         * @return Maps to pass to cv::remap
+         */
+        std::shared_ptr<const Tables> Get(const cv::Size &outputSize,
+                                          const cv::Matx23d &reverseTransformationMatrix);
+
+        Stats GetStats() const;
+
+        /**
+         * Removes all of the tables from the cache.
+         */
+        void Clear();
+
+
+        static constexpr std::size_t DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+
+    private:
+        using Key = std::array<double, 8>;
+
+        struct Entry {
+            std::shared_ptr<const Tables> tables;
+            // Position in lruKeys_.
+            std::list<Key>::iterator lruPosition;
+        };
+
+        const std::size_t maxBytes_;
+
+        mutable std::mutex mutex_;
+
+        std::map<Key, Entry> entries_;
+
+        // Most recently used key is at the front.
+        std::list<Key> lruKeys_;
+
+        Stats stats_;
+
+        static std::shared_ptr<const Tables> CreateTables(
+                const cv::Size &outputSize, const cv::Matx23d &reverseTransformationMatrix);
+
+        void EvictUntilFits(std::size_t newBytes);
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_REMAPTABLECACHE_H
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_SEEKCOSTMODEL_H
+#define OPENMPF_CPP_COMPONENT_SDK_SEEKCOSTMODEL_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * Learns how long it takes to move forward through a video with cv::VideoCapture::grab and
+     * how long it takes to set the frame position with
+     * cv::VideoCapture::set(cv::CAP_PROP_POS_FRAMES, int), so that SetFramePositionSeek can pick
+     * the cheaper one for each seek. Both costs depend on the codec, resolution, and key frame
+     * interval, so there is a model for each video, shared by the captures in the process.
+     *
+     * Until both costs have been measured, the model grabs when moving forward
+     * DEFAULT_MAX_GRAB_FRAMES or fewer frames.
+     */
+    class SeekCostModel {
+    public:
+        /**
+         * @return The process-wide model for videoPath
+         */
+        static std::shared_ptr<SeekCostModel> GetForVideo(const std::string &videoPath);
+
+        /**
+         * @param frameCount Number of frames between the current position and the requested
+         *                   position
+         * @return true if grabbing frameCount frames is expected to be faster than setting the
+         *         frame position
+         */
+        bool ShouldGrab(int frameCount) const;
+
+        void AddGrabSample(int frameCount, double milliseconds);
+
+        void AddSetPositionSample(double milliseconds);
+
+        /**
+         * @return Average time to grab one frame, or a negative number if no grabs have been measured
+         */
+        double GetGrabMillisPerFrame() const;
+
+        /**
+         * @return Average time to set the frame position, or a negative number if it has not
+         *         been measured
+         */
+        double GetSetPositionMillis() const;
+
+
+        // When setting frame position, OpenCV sets the frame position to 16 frames before the
+        // requested frame in order to locate the closest key frame. Once OpenCV locates the key
+        // frame, it uses cv::VideoCapture::grab to advance cv::VideoCapture's position.
+        // This means that when you need to advance 16 or fewer frames, it is more efficient to
+        // just use cv::VideoCapture::grab.
+        // https://github.com/opencv/opencv/blob/4.9.0/modules/videoio/src/cap_ffmpeg_impl.hpp#L1959
+        static constexpr int DEFAULT_MAX_GRAB_FRAMES = 16;
+
+    private:
+        mutable std::mutex mutex_;
+
+        double grabMillisPerFrame_ = -1;
+
+        double setPositionMillis_ = -1;
+
+        // Weight of the newest sample in the exponential moving averages, so that the model
+        // follows changes like the decoder warming up or the file being cached by the OS.
+        static constexpr double NEW_SAMPLE_WEIGHT = 0.2;
+
+        static void AddSample(double &average, double sample);
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_SEEKCOSTMODEL_H
@@ -0,0 +1,111 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_SEEKSTATISTICS_H
+#define OPENMPF_CPP_COMPONENT_SDK_SEEKSTATISTICS_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * Records how MPFVideoCapture changed its frame position, so that jobs that spend most of
+     * their time seeking can be found. Reading consecutive frames is not a seek, so only the
+     * jumps caused by frame filters and by explicitly setting the frame position are recorded.
+     */
+    class SeekStatistics {
+    public:
+        struct Seek {
+            // Name of the SeekStrategy that was used.
+            std::string strategy;
+            // Original frame position before the seek.
+            int startFrame;
+            int requestedFrame;
+            // Original frame position after the seek. Differs from requestedFrame when the seek failed.
+            int resultFrame;
+            // Frames grabbed or read by the strategy. This does not include the frames that
+            // cv::VideoCapture decodes internally when setting the frame position.
+            int framesDecoded;
+            double wallTimeMillis;
+        };
+
+        struct Fallback {
+            std::string fromStrategy;
+            // Empty when there were no strategies left to fall back to.
+            std::string toStrategy;
+        };
+
+        struct StrategyTotals {
+            int seekCount = 0;
+            int failedSeekCount = 0;
+            long framesDecoded = 0;
+            double wallTimeMillis = 0;
+        };
+
+        explicit SeekStatistics(std::string videoPath);
+
+        void AddSeek(Seek seek);
+
+        void AddFallback(Fallback fallback);
+
+        const std::string& GetVideoPath() const;
+
+        /**
+         * @return The first MAX_RECORDED_SEEKS seeks. Every seek is included in GetTotals.
+         */
+        const std::vector<Seek>& GetSeeks() const;
+
+        const std::vector<Fallback>& GetFallbacks() const;
+
+        /**
+         * @return Totals for each strategy, keyed by strategy name
+         */
+        const std::map<std::string, StrategyTotals>& GetTotals() const;
+
+        /**
+         * @return The statistics as a single line JSON object
+         */
+        std::string ToJson() const;
+
+
+        static constexpr std::size_t MAX_RECORDED_SEEKS = 10000;
+
+    private:
+        std::string videoPath_;
+
+        std::vector<Seek> seeks_;
+
+        std::vector<Fallback> fallbacks_;
+
+        std::map<std::string, StrategyTotals> totals_;
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_SEEKSTATISTICS_H
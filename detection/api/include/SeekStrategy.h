@@ -31,6 +31,11 @@
 
 #include <opencv2/videoio.hpp>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include "KeyFrameIndex.h"
+#include "SeekCostModel.h"
 
 namespace MPF { namespace COMPONENT {
 
@@ -48,6 +53,16 @@ namespace MPF { namespace COMPONENT {
         virtual int ChangePosition(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const = 0;
 
         virtual SeekStrategy::CPtr fallback() const = 0;
+
+        virtual const char* GetName() const = 0;
+
+        /**
+         * @return Number of frames grabbed or read during the most recent call to ChangePosition
+         */
+        int GetFramesDecodedByLastSeek() const;
+
+    protected:
+        mutable int framesDecoded_ = 0;
     };
 
 
@@ -65,6 +80,8 @@ namespace MPF { namespace COMPONENT {
     public:
         SeekStrategy::CPtr fallback() const override;
 
+        const char* GetName() const override;
+
     private:
         bool Advance(cv::VideoCapture &cap) const override;
     };
@@ -74,27 +91,123 @@ namespace MPF { namespace COMPONENT {
     public:
         SeekStrategy::CPtr fallback() const override;
 
+        const char* GetName() const override;
+
     private:
         bool Advance(cv::VideoCapture &cap) const override;
     };
 
 
+    /**
+     * Loads a video's KeyFrameIndex the first time it is needed, so that jobs that never seek
+     * far do not have to run ffprobe. When the index can not be loaded, the error is reported
+     * once and Get returns nullptr.
+     */
+    class LazyKeyFrameIndex {
+    public:
+        LazyKeyFrameIndex(std::string videoPath, bool useDiskCache);
+
+        const KeyFrameIndex::KeyFrames* Get() const;
+
+        /**
+         * @return The last key frame at or before frame, or 0 if there is none or the index
+         *         could not be loaded
+         */
+        int GetKeyFrameAtOrBefore(int frame) const;
+
+    private:
+        std::string videoPath_;
+
+        bool useDiskCache_;
+
+        mutable bool loaded_ = false;
+
+        mutable std::shared_ptr<const KeyFrameIndex::KeyFrames> keyFrames_;
+    };
+
+
+    /**
+     * Uses the video's KeyFrameIndex to seek to the key frame at or before the requested frame
+     * and then grabs forward to the requested frame. Each seek is verified by comparing the
+     * presentation time of the frame it lands on with the time of the key frame in the index,
+     * so the frame position is exact even for variable frame rate videos. Any seek that cannot
+     * be verified is redone from the start of the video, like GrabSeek.
+     *
+     * When moving forward, it only seeks when that is expected to decode fewer frames than
+     * grabbing, so a job whose frame interval is longer than the distance between key frames
+     * jumps from key frame to key frame.
+     */
+    class IndexedSeek : public SeekStrategy {
+    public:
+        IndexedSeek(std::string videoPath, bool useDiskCache);
+
+        explicit IndexedSeek(std::shared_ptr<const LazyKeyFrameIndex> keyFrameIndex);
+
+        int ChangePosition(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const override;
+
+        SeekStrategy::CPtr fallback() const override;
+
+        const char* GetName() const override;
+
+    private:
+        std::shared_ptr<const LazyKeyFrameIndex> keyFrameIndex_;
+
+        GrabSeek grabSeek_;
+
+        bool SeekingIsFaster(const std::vector<int> &keyFrames, int currentPosition,
+                             int requestedPosition) const;
+
+        int GrabForward(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const;
+
+        // Returns the position after the key frame, or -1 when the key frame was not found.
+        int SeekToKeyFrame(cv::VideoCapture &cap, int keyFrame, double keyFrameTime) const;
+
+        // Maximum number of frames to grab while looking for the key frame after a seek.
+        // OpenCV's seek can stop slightly before the requested time when timestamps are
+        // closer together than the average frame rate suggests.
+        static constexpr int MAX_KEY_FRAME_SEARCH_FRAMES = 32;
+
+        // Number of average frame durations before the key frame to seek to.
+        static constexpr int SEEK_MARGIN_FRAMES = 3;
+
+        // Frame times from the index are rounded to the microsecond.
+        static constexpr double TIME_TOLERANCE_MS = 0.01;
+    };
+
+
     class SetFramePositionSeek : public SeekStrategy {
     public:
+        SetFramePositionSeek() = default;
+
+        /**
+         * @param costModel Used to decide whether to grab or set the frame position when moving
+         *                  forward. When null, SeekCostModel::DEFAULT_MAX_GRAB_FRAMES is used.
+         * @param keyFrameIndex When not null, falls back to an IndexedSeek using this index
+         *                      instead of a GrabSeek
+         * @param planWithKeyFrames When true, keyFrameIndex is used instead of costModel to decide
+         *                          whether to grab or set the frame position, by counting the
+         *                          frames each would decode
+         */
+        explicit SetFramePositionSeek(std::shared_ptr<SeekCostModel> costModel,
+                                      std::shared_ptr<const LazyKeyFrameIndex> keyFrameIndex = nullptr,
+                                      bool planWithKeyFrames = false);
+
         int ChangePosition(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const override;
 
         SeekStrategy::CPtr fallback() const override;
 
+        const char* GetName() const override;
+
     private:
         GrabSeek grabSeek_;
 
-        // When setting frame position, OpenCV sets the frame position to 16 frames before the
-        // requested frame in order to locate the closest key frame. Once OpenCV locates the key
-        // frame, it uses cv::VideoCapture::grab to advance cv::VideoCapture's position.
-        // This means that when you need to advance 16 or fewer frames, it is more efficient to
-        // just use cv::VideoCapture::grab.
-        // https://github.com/opencv/opencv/blob/4.9.0/modules/videoio/src/cap_ffmpeg_impl.hpp#L1959
-        static constexpr int SET_POS_MIN_FRAMES = 16;
+        std::shared_ptr<SeekCostModel> costModel_;
+
+        std::shared_ptr<const LazyKeyFrameIndex> keyFrameIndex_;
+
+        bool planWithKeyFrames_ = false;
+
+        bool ShouldGrab(int currentPosition, int requestedPosition) const;
     };
 }}
 
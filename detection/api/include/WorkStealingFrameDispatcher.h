@@ -0,0 +1,164 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_WORKSTEALINGFRAMEDISPATCHER_H
+#define OPENMPF_CPP_COMPONENT_SDK_WORKSTEALINGFRAMEDISPATCHER_H
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "MPFAsyncVideoCapture.h"
+
+namespace MPF::COMPONENT {
+
+    /**
+     * Distributes the frames from an MPFAsyncVideoCapture to a fixed number of worker threads.
+     * Each worker has its own deque of frames. A worker takes frames from the front of its own
+     * deque and, when that is empty, steals from the back of another worker's deque. Only when
+     * every deque is empty does a worker read a new batch from the MPFAsyncVideoCapture, so
+     * workers rarely contend on the same lock.
+     *
+     * Since workers finish frames out of order, components that build tracks should collect their
+     * per-frame results in an OrderedFrameResults.
+     *
+     * Only one worker at a time reads from the MPFAsyncVideoCapture, so it is safe to use with
+     * USE_LOCK_FREE_FRAME_QUEUE. The MPFAsyncVideoCapture must outlive the dispatcher and must
+     * not be read from directly while the dispatcher is in use.
+     */
+    class WorkStealingFrameDispatcher {
+    public:
+        /**
+         * @param videoCapture Source of the frames
+         * @param workerCount Number of worker threads that will call Read
+         * @param batchSize Number of frames given to each worker when the deques are refilled
+         */
+        WorkStealingFrameDispatcher(MPFAsyncVideoCapture &videoCapture, int workerCount,
+                                    int batchSize=4);
+
+        /**
+         * Gets the next frame for a worker. May be called concurrently from different worker
+         * threads, but each worker index must only be used by one thread.
+         * @param workerIndex Index of the calling worker, from 0 to workerCount - 1
+         * @return The next frame or an empty optional when all of the frames have been read.
+         */
+        std::optional<MPFFrame> Read(int workerIndex);
+
+        int GetWorkerCount() const;
+
+        /**
+         * @return The number of frames that were taken from another worker's deque.
+         */
+        long GetStealCount() const;
+
+
+    private:
+        struct WorkerDeque {
+            std::mutex mutex;
+            std::deque<MPFFrame> frames;
+        };
+
+        MPFAsyncVideoCapture &videoCapture_;
+
+        int batchSize_;
+
+        std::vector<std::unique_ptr<WorkerDeque>> workerDeques_;
+
+        // Guards reading from videoCapture_ and sourceExhausted_.
+        std::mutex refillMutex_;
+
+        bool sourceExhausted_ = false;
+
+        std::atomic<long> stealCount_{0};
+
+        std::optional<MPFFrame> PopLocal(int workerIndex);
+
+        std::optional<MPFFrame> Steal(int workerIndex);
+
+        bool Refill(int workerIndex);
+
+        bool AllDequesEmpty();
+    };
+
+
+
+    /**
+     * Collects per-frame results that may be added in any order and releases them in frame
+     * index order. Add may be called concurrently from multiple threads.
+     */
+    template <typename T>
+    class OrderedFrameResults {
+    public:
+        explicit OrderedFrameResults(int firstFrameIndex=0)
+            : nextFrameIndex_(firstFrameIndex)
+        {
+        }
+
+        void Add(int frameIndex, T result) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.emplace(frameIndex, std::move(result));
+        }
+
+        /**
+         * Removes the results for the frames that immediately follow the last frame that was
+         * previously taken. Stops at the first frame that does not have a result yet.
+         * @return The results in frame index order
+         */
+        std::vector<T> TakeReady() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<T> ready;
+            auto it = pending_.begin();
+            while (it != pending_.end() && it->first == nextFrameIndex_) {
+                ready.push_back(std::move(it->second));
+                it = pending_.erase(it);
+                nextFrameIndex_++;
+            }
+            return ready;
+        }
+
+        /**
+         * @return The index of the frame whose result will be returned first by the next call to
+         *         TakeReady
+         */
+        int GetNextFrameIndex() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return nextFrameIndex_;
+        }
+
+
+    private:
+        std::mutex mutex_;
+        std::map<int, T> pending_;
+        int nextFrameIndex_;
+    };
+}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_WORKSTEALINGFRAMEDISPATCHER_H
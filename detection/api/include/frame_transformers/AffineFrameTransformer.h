@@ -27,6 +27,11 @@
 #ifndef OPENMPF_CPP_COMPONENT_SDK_AFFINEFRAMETRANSFORMER_H
 #define OPENMPF_CPP_COMPONENT_SDK_AFFINEFRAMETRANSFORMER_H
 
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <tuple>
 #include <vector>
 
@@ -37,10 +42,27 @@
 #include "MPFDetectionObjects.h"
 #include "SearchRegion.h"
 #include "MPFRotatedRect.h"
+#include "RemapTableCache.h"
 
 
 namespace MPF { namespace COMPONENT {
 
+    /**
+     * Interpolation used when a frame needs to be resampled. Rotations by a multiple of 90 degrees
+     * never need to be resampled, so they are not affected by this setting.
+     */
+    enum class RotationInterpolation {
+        NEAREST,
+        LINEAR,
+        CUBIC,
+        LANCZOS4,
+        // Bilinear interpolation using fixed-point remap tables that are computed on first use and
+        // then reused for every frame. The tables are kept in RemapTableCache::GetInstance(), so
+        // jobs that use the same frame size and transformation share them. Feed forward exact
+        // region jobs use a different transformation for every frame, so they use LINEAR instead.
+        FAST
+    };
+
 
     class AffineTransformation {
     public:
@@ -48,12 +70,15 @@ namespace MPF { namespace COMPONENT {
                 const std::vector<MPFRotatedRect> &preTransformRegions,
                 double frameRotationDegrees, bool flip,
                 const cv::Scalar &fillColor,
-                const SearchRegion &postTransformSearchRegion = {});
+                const SearchRegion &postTransformSearchRegion = {},
+                RotationInterpolation interpolation = RotationInterpolation::CUBIC);
 
         void Apply(cv::Mat &frame) const;
 
         void ApplyReverse(MPFImageLocation &imageLocation) const;
 
+        void ApplyReverse(const std::vector<MPFImageLocation*> &imageLocations) const;
+
         cv::Size2d GetRegionSize() const;
 
     private:
@@ -65,8 +90,28 @@ namespace MPF { namespace COMPONENT {
 
         cv::Scalar fillColor_;
 
+        RotationInterpolation interpolation_;
+
         // OpenCV does the mapping in the reverse order (from destination to the source) to avoid sampling artifacts.
         cv::Matx23d reverseTransformationMatrix_;
+
+        // Set when every output pixel comes from exactly one input pixel. That is the case for
+        // whole-pixel translations and for multiples of 90 degree rotations, with or without a flip.
+        // Apply then crops, transposes, and flips the frame instead of calling cv::warpAffine.
+        std::optional<cv::Matx23i> wholePixelMapping_;
+
+        void ApplyWholePixelMapping(cv::Mat &frame) const;
+
+        struct RemapTablesHandle {
+            std::once_flag initialized;
+            std::shared_ptr<const RemapTableCache::Tables> tables;
+        };
+
+        // Only set when interpolation_ is FAST. The handle is shared with copies of this object and
+        // the tables are shared with every transformation in the process that has the same matrix.
+        std::shared_ptr<RemapTablesHandle> remapTables_;
+
+        const RemapTableCache::Tables& GetRemapTables() const;
     };
 
 
@@ -77,16 +122,19 @@ namespace MPF { namespace COMPONENT {
         // Search region frame cropping on rotated frame constructor.
         AffineFrameTransformer(double rotation, bool flip, const cv::Scalar &fillColor,
                                const SearchRegion &searchRegion,
-                               IFrameTransformer::Ptr innerTransform);
+                               IFrameTransformer::Ptr innerTransform,
+                               RotationInterpolation interpolation = RotationInterpolation::CUBIC);
 
         // Rotate full frame constructor.
         AffineFrameTransformer(double rotation, bool flip, const cv::Scalar &fillColor,
-                               IFrameTransformer::Ptr innerTransform);
+                               IFrameTransformer::Ptr innerTransform,
+                               RotationInterpolation interpolation = RotationInterpolation::CUBIC);
 
         // Feed forward superset region constructor
         AffineFrameTransformer(const std::vector<MPFRotatedRect> &regions,
                                double frameRotation, bool frameFlip, const cv::Scalar &fillColor,
-                               IFrameTransformer::Ptr innerTransform);
+                               IFrameTransformer::Ptr innerTransform,
+                               RotationInterpolation interpolation = RotationInterpolation::CUBIC);
 
         cv::Size GetFrameSize(int frameIndex) const override;
 
@@ -95,20 +143,29 @@ namespace MPF { namespace COMPONENT {
         void DoFrameTransform(cv::Mat &frame, int frameIndex) const override;
 
         void DoReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const override;
-        
+
+        void DoReverseTransformAll(const std::vector<MPFImageLocation*> &imageLocations,
+                                   const std::vector<int> &frameIndices) const override;
+
     private:
         const AffineTransformation transform_;
     };
 
 
 
+    /**
+     * Each frame gets its own transformation, so tracks can have a large number of them. Only the
+     * regions are stored up front. The transformations are built when a frame is first used and
+     * only the most recently used ones are kept.
+     */
     class FeedForwardExactRegionAffineTransformer : public BaseDecoratedTransformer {
 
     public:
         // Feed forward exact region constructor
-        FeedForwardExactRegionAffineTransformer(const std::vector<MPFRotatedRect> &regions,
+        FeedForwardExactRegionAffineTransformer(std::vector<MPFRotatedRect> regions,
                                                 const cv::Scalar &fillColor,
-                                                IFrameTransformer::Ptr innerTransform);
+                                                IFrameTransformer::Ptr innerTransform,
+                                                RotationInterpolation interpolation = RotationInterpolation::CUBIC);
 
         cv::Size GetFrameSize(int frameIndex) const override;
 
@@ -119,13 +176,24 @@ namespace MPF { namespace COMPONENT {
         void DoReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const override;
 
     private:
-        const std::vector<AffineTransformation> frameTransforms_;
+        // Enough for the frames that are in flight when the frames are transformed in parallel.
+        static constexpr std::size_t MAX_CACHED_TRANSFORMS = 16;
+
+        const std::vector<MPFRotatedRect> regions_;
+
+        const cv::Scalar fillColor_;
+
+        const RotationInterpolation interpolation_;
+
+        mutable std::mutex transformsMutex_;
 
-        const AffineTransformation& GetTransform(int frameIndex) const;
+        // Keyed by frame index. When full, the lowest frame index is dropped since frames are
+        // generally processed in order.
+        mutable std::map<int, std::shared_ptr<const AffineTransformation>> cachedTransforms_;
 
-        static std::vector<AffineTransformation> CreateTransformations(
-                const std::vector<MPFRotatedRect> &regions, const cv::Scalar &fillColor);
+        std::shared_ptr<const AffineTransformation> GetTransform(int frameIndex) const;
 
+        std::shared_ptr<const AffineTransformation> CreateTransformation(int frameIndex) const;
     };
 }}
 
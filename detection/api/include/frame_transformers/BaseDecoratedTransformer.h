@@ -29,6 +29,8 @@
 #ifndef OPENMPF_CPP_COMPONENT_SDK_BASEDECORATEDTRANSFORMER_H
 #define OPENMPF_CPP_COMPONENT_SDK_BASEDECORATEDTRANSFORMER_H
 
+#include <vector>
+
 #include <opencv2/core.hpp>
 
 #include "MPFDetectionComponent.h"
@@ -59,6 +61,15 @@ namespace MPF { namespace COMPONENT {
         void TransformFrame(cv::Mat &frame, int frameIndex) const override;
 
 
+        /**
+         * Passes the whole batch to the inner transform before calling the subclass's
+         * doFrameTransform method on each frame.
+         * @param frames[in,out] Frames to transform.
+         * @param firstFrameIndex 0-based index of the first frame in frames.
+         */
+        void TransformFrames(std::vector<cv::Mat> &frames, int firstFrameIndex) const override;
+
+
         /**
          * Calls the subclass's doReverseTransform before calling the inner transformer's reverseTransform.
          * @param imageLocation[in,out]  The image location to do the reverse transform on.
@@ -67,6 +78,16 @@ namespace MPF { namespace COMPONENT {
         void ReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const override;
 
 
+        /**
+         * Calls the subclass's doReverseTransformAll on the whole batch before passing the batch to
+         * the inner transformer.
+         * @param imageLocations[in,out] The image locations to do the reverse transform on.
+         * @param frameIndices 0-based index of the frame in which each detection was found.
+         */
+        void ReverseTransformAll(const std::vector<MPFImageLocation*> &imageLocations,
+                                 const std::vector<int> &frameIndices) const override;
+
+
     protected:
         explicit BaseDecoratedTransformer(IFrameTransformer::Ptr frameTransformer);
 
@@ -85,6 +106,16 @@ namespace MPF { namespace COMPONENT {
          */
         virtual void DoReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const = 0;
 
+
+        /**
+         * Subclasses can override this method to reverse transform a batch of detections at once.
+         * By default, doReverseTransform is called on each detection.
+         * @param imageLocations[in,out] The image locations to do the reverse transform on.
+         * @param frameIndices 0-based index of the frame in which each detection was found.
+         */
+        virtual void DoReverseTransformAll(const std::vector<MPFImageLocation*> &imageLocations,
+                                           const std::vector<int> &frameIndices) const;
+
         cv::Size GetInnerFrameSize(int frameIndex) const;
 
     private:
@@ -37,10 +37,29 @@
 
 namespace MPF { namespace COMPONENT {
 
+    /**
+     * Controls what FrameCropper does with the pixels outside of the region of interest.
+     */
+    enum class CropPolicy {
+        /**
+         * The cropped frame is a view in to the original frame. No pixels are copied, but the
+         * entire original frame stays in memory for as long as the cropped frame does.
+         */
+        KEEP_VIEW,
+        /**
+         * The region of interest is copied in to a contiguous buffer from
+         * FramePool::GetInstance() and the original frame is released. This is better when the
+         * region is much smaller than the frame or when the cropped frames are queued.
+         */
+        COMPACT_COPY
+    };
+
+
     class FrameCropper : public BaseDecoratedTransformer {
 
     public:
-        explicit FrameCropper(IFrameTransformer::Ptr innerTransform);
+        explicit FrameCropper(IFrameTransformer::Ptr innerTransform,
+                              CropPolicy cropPolicy=CropPolicy::KEEP_VIEW);
 
         cv::Size GetFrameSize(int frameIndex) const override;
 
@@ -54,6 +73,8 @@ namespace MPF { namespace COMPONENT {
 
 
     private:
+        const CropPolicy cropPolicy_;
+
         virtual cv::Rect GetRegionOfInterest(int frameIndex) const = 0;
     };
 
@@ -62,7 +83,8 @@ namespace MPF { namespace COMPONENT {
 
     class SearchRegionFrameCropper : public FrameCropper {
     public:
-        SearchRegionFrameCropper(const cv::Rect &regionOfInterest, IFrameTransformer::Ptr innerTransform);
+        SearchRegionFrameCropper(const cv::Rect &regionOfInterest, IFrameTransformer::Ptr innerTransform,
+                                 CropPolicy cropPolicy=CropPolicy::KEEP_VIEW);
 
     private:
         const cv::Rect searchRegion_;
@@ -75,7 +97,8 @@ namespace MPF { namespace COMPONENT {
 
     class FeedForwardFrameCropper : public FrameCropper {
     public:
-        FeedForwardFrameCropper(const std::map<int, MPFImageLocation> &track, IFrameTransformer::Ptr innerTransform);
+        FeedForwardFrameCropper(const std::map<int, MPFImageLocation> &track, IFrameTransformer::Ptr innerTransform,
+                                CropPolicy cropPolicy=CropPolicy::KEEP_VIEW);
 
     private:
         std::vector<cv::Rect> fedForwardDetections_;
@@ -0,0 +1,76 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_FRAMESCALER_H
+#define OPENMPF_CPP_COMPONENT_SDK_FRAMESCALER_H
+
+
+#include <opencv2/core.hpp>
+
+#include "BaseDecoratedTransformer.h"
+#include "MPFDetectionComponent.h"
+#include "IFrameTransformer.h"
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * Shrinks frames to a fixed size and scales detections back up to the size of the inner
+     * transformer's frames. FrameTransformerFactory puts it right after the decoder, so the
+     * other transformers and the component work with the smaller frames.
+     */
+    class FrameScaler : public BaseDecoratedTransformer {
+
+    public:
+        FrameScaler(const cv::Size &scaledSize, IFrameTransformer::Ptr innerTransform);
+
+        cv::Size GetFrameSize(int frameIndex) const override;
+
+        /**
+         * @param frameSize Size of the unscaled frames
+         * @param maxDimension Maximum width or height of the scaled frames
+         * @return The largest size no bigger than maxDimension on either side that has the same
+         *         aspect ratio as frameSize, or frameSize when it is already small enough
+         */
+        static cv::Size GetScaledSize(const cv::Size &frameSize, int maxDimension);
+
+
+    protected:
+        void DoFrameTransform(cv::Mat &frame, int frameIndex) const override;
+
+        void DoReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const override;
+
+
+    private:
+        const cv::Size scaledSize_;
+
+        // Multiply by these to go from scaled coordinates to the inner transformer's coordinates.
+        const double reverseScaleX_;
+
+        const double reverseScaleY_;
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_FRAMESCALER_H
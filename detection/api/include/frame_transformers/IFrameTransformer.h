@@ -30,6 +30,7 @@
 
 
 #include <memory>
+#include <vector>
 
 #include <opencv2/core.hpp>
 
@@ -47,8 +48,33 @@ namespace MPF { namespace COMPONENT {
 
         virtual void TransformFrame(cv::Mat &frame, int frameIndex) const = 0;
 
+        /**
+         * Transforms a batch of consecutive frames.
+         * @param frames[in,out] Frames to transform
+         * @param firstFrameIndex 0-based index of the first frame in frames. frames[i] has index
+         *                        firstFrameIndex + i.
+         */
+        virtual void TransformFrames(std::vector<cv::Mat> &frames, int firstFrameIndex) const {
+            for (size_t i = 0; i < frames.size(); i++) {
+                TransformFrame(frames[i], firstFrameIndex + static_cast<int>(i));
+            }
+        }
+
         virtual void ReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const = 0;
 
+        /**
+         * Reverse transforms a batch of detections, such as all of the detections in a track.
+         * @param imageLocations[in,out] Detections to reverse transform
+         * @param frameIndices 0-based index of the frame in which each detection was found.
+         *                     frameIndices[i] is the index for imageLocations[i].
+         */
+        virtual void ReverseTransformAll(const std::vector<MPFImageLocation*> &imageLocations,
+                                         const std::vector<int> &frameIndices) const {
+            for (size_t i = 0; i < imageLocations.size(); i++) {
+                ReverseTransform(*imageLocations[i], frameIndices[i]);
+            }
+        }
+
         virtual cv::Size GetFrameSize(int frameIndex) const = 0;
     };
 }}
@@ -29,6 +29,8 @@
 #define OPENMPF_CPP_COMPONENT_SDK_NOOPFRAMETRANSFORMER_H
 
 
+#include <vector>
+
 #include <opencv2/core.hpp>
 
 #include "MPFDetectionComponent.h"
@@ -47,8 +49,13 @@ namespace MPF { namespace COMPONENT {
 
         void TransformFrame(cv::Mat &frame, int frameIndex) const override;
 
+        void TransformFrames(std::vector<cv::Mat> &frames, int firstFrameIndex) const override;
+
         void ReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const override;
 
+        void ReverseTransformAll(const std::vector<MPFImageLocation*> &imageLocations,
+                                 const std::vector<int> &frameIndices) const override;
+
     private:
         const cv::Size frameSize_;
     };
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "FramePool.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <unistd.h>
+
+
+namespace MPF { namespace COMPONENT {
+
+    namespace {
+        std::size_t GetPageSize() {
+            static const std::size_t pageSize = [] {
+                long size = sysconf(_SC_PAGESIZE);
+                return size > 0 ? static_cast<std::size_t>(size) : 4096;
+            }();
+            return pageSize;
+        }
+
+        // std::aligned_alloc requires the size to be a multiple of the alignment.
+        std::size_t RoundUpToPageSize(std::size_t size) {
+            std::size_t pageSize = GetPageSize();
+            return ((size + pageSize - 1) / pageSize) * pageSize;
+        }
+    }
+
+
+    double FramePool::Stats::GetHitRate() const {
+        if (requestCount == 0) {
+            return 0;
+        }
+        return static_cast<double>(hitCount) / requestCount;
+    }
+
+
+    FramePool::FramePool(std::size_t maxIdleBytes)
+        : maxIdleBytes_(maxIdleBytes)
+    {
+    }
+
+
+    FramePool::~FramePool() {
+        Clear();
+    }
+
+
+    FramePool& FramePool::GetInstance() {
+        // Intentionally leaked so that frames released during static destruction can still
+        // be returned to the pool.
+        static auto *instance = new FramePool;
+        return *instance;
+    }
+
+
+    void FramePool::Use(cv::Mat &mat) {
+        mat.allocator = this;
+    }
+
+
+    FramePool::Stats FramePool::GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+
+    void FramePool::Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &sizeBufferPair : idleBuffers_) {
+            std::free(sizeBufferPair.second);
+        }
+        idleBuffers_.clear();
+        stats_.idleBytes = 0;
+    }
+
+
+    // Based on cv::StdMatAllocator.
+    cv::UMatData* FramePool::allocate(int dims, const int *sizes, int type, void *data0,
+                                      size_t *step, cv::AccessFlag flags,
+                                      cv::UMatUsageFlags usageFlags) const {
+        std::size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step != nullptr) {
+                if (data0 != nullptr && step[i] != cv::Mat::AUTO_STEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                }
+                else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        auto *u = new cv::UMatData(this);
+        if (data0 == nullptr) {
+            u->data = u->origdata = static_cast<uchar*>(AcquireBuffer(RoundUpToPageSize(total)));
+        }
+        else {
+            u->data = u->origdata = static_cast<uchar*>(data0);
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        }
+        u->size = total;
+        return u;
+    }
+
+
+    bool FramePool::allocate(cv::UMatData *data, cv::AccessFlag accessFlags,
+                             cv::UMatUsageFlags usageFlags) const {
+        return data != nullptr;
+    }
+
+
+    void FramePool::deallocate(cv::UMatData *u) const {
+        if (u == nullptr) {
+            return;
+        }
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+            ReleaseBuffer(u->origdata, RoundUpToPageSize(u->size));
+            u->origdata = nullptr;
+        }
+        delete u;
+    }
+
+
+    void* FramePool::AcquireBuffer(std::size_t size) const {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.requestCount++;
+            auto iter = idleBuffers_.find(size);
+            if (iter != idleBuffers_.end()) {
+                void *buffer = iter->second;
+                idleBuffers_.erase(iter);
+                stats_.idleBytes -= size;
+                stats_.hitCount++;
+                return buffer;
+            }
+            stats_.allocationCount++;
+        }
+
+        void *buffer = std::aligned_alloc(GetPageSize(), size);
+        if (buffer == nullptr) {
+            throw std::bad_alloc();
+        }
+        return buffer;
+    }
+
+
+    void FramePool::ReleaseBuffer(void *buffer, std::size_t size) const {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stats_.idleBytes + size <= maxIdleBytes_) {
+                idleBuffers_.emplace(size, buffer);
+                stats_.idleBytes += size;
+                return;
+            }
+        }
+        std::free(buffer);
+    }
+}}
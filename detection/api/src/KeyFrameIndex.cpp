@@ -0,0 +1,378 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "KeyFrameIndex.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+
+namespace MPF { namespace COMPONENT {
+
+    namespace {
+        constexpr const char *CACHE_FILE_HEADER = "MPF_KEY_FRAME_INDEX_V2";
+
+        // Enough for the videos that the segment jobs running in one process are likely to share.
+        constexpr std::size_t MAX_MEMORY_CACHE_ENTRIES = 64;
+
+        struct FileVersion {
+            std::uintmax_t size;
+            std::int64_t modificationTime;
+
+            bool operator==(const FileVersion &other) const {
+                return size == other.size && modificationTime == other.modificationTime;
+            }
+        };
+
+
+        // Returns nothing when the video is not a regular file, such as when it is a URL.
+        std::optional<FileVersion> GetFileVersion(const std::string &path) {
+            std::error_code error;
+            if (!std::filesystem::is_regular_file(path, error)) {
+                return {};
+            }
+            auto size = std::filesystem::file_size(path, error);
+            if (error) {
+                return {};
+            }
+            auto modificationTime = std::filesystem::last_write_time(path, error);
+            if (error) {
+                return {};
+            }
+            return FileVersion{
+                size,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        modificationTime.time_since_epoch()).count()
+            };
+        }
+
+
+        std::optional<KeyFrameIndex::KeyFrames> ReadDiskCache(const std::string &cachePath,
+                                                              const FileVersion &version) {
+            std::ifstream cacheFile(cachePath);
+            if (!cacheFile) {
+                return {};
+            }
+            std::string header;
+            FileVersion cachedVersion{};
+            std::size_t keyFrameCount = 0;
+            if (!(cacheFile >> header >> cachedVersion.size >> cachedVersion.modificationTime
+                            >> keyFrameCount)
+                    || header != CACHE_FILE_HEADER
+                    || !(cachedVersion == version)) {
+                return {};
+            }
+
+            KeyFrameIndex::KeyFrames keyFrames;
+            keyFrames.frameNumbers.resize(keyFrameCount);
+            keyFrames.timesInMillis.resize(keyFrameCount);
+            for (std::size_t i = 0; i < keyFrameCount; i++) {
+                if (!(cacheFile >> keyFrames.frameNumbers[i] >> keyFrames.timesInMillis[i])) {
+                    return {};
+                }
+            }
+            return keyFrames;
+        }
+
+
+        // Failing to write the cache only means that the next job has to run ffprobe again, so
+        // errors are ignored.
+        void WriteDiskCache(const std::string &cachePath, const FileVersion &version,
+                            const KeyFrameIndex::KeyFrames &keyFrames) {
+            // Write to a temporary file and then rename it so that other processes never read a
+            // partially written index.
+            std::string tempPath = cachePath + ".tmp" + std::to_string(getpid());
+            {
+                std::ofstream cacheFile(tempPath);
+                if (!cacheFile) {
+                    return;
+                }
+                cacheFile.precision(std::numeric_limits<double>::max_digits10);
+                cacheFile << CACHE_FILE_HEADER << ' ' << version.size << ' '
+                          << version.modificationTime << ' ' << keyFrames.frameNumbers.size() << '\n';
+                for (std::size_t i = 0; i < keyFrames.frameNumbers.size(); i++) {
+                    cacheFile << keyFrames.frameNumbers[i] << ' ' << keyFrames.timesInMillis[i] << '\n';
+                }
+                if (!cacheFile.flush()) {
+                    cacheFile.close();
+                    std::remove(tempPath.c_str());
+                    return;
+                }
+            }
+            std::error_code error;
+            std::filesystem::rename(tempPath, cachePath, error);
+            if (error) {
+                std::remove(tempPath.c_str());
+            }
+        }
+
+
+        std::optional<double> ParseTime(const std::string &field) {
+            try {
+                std::size_t endPos = 0;
+                double timestamp = std::stod(field, &endPos);
+                if (endPos == field.size()) {
+                    return timestamp;
+                }
+            }
+            catch (const std::logic_error&) {
+                // "N/A" when the container does not have the timestamp.
+            }
+            return {};
+        }
+
+
+        struct MemoryCacheEntry {
+            FileVersion version;
+            std::shared_ptr<const KeyFrameIndex::KeyFrames> keyFrames;
+            // Value of memoryCacheUseCount when the entry was last used.
+            std::uint64_t lastUse;
+        };
+
+        std::mutex memoryCacheMutex;
+
+        std::unordered_map<std::string, MemoryCacheEntry> memoryCache;
+
+        std::uint64_t memoryCacheUseCount = 0;
+
+        // Keyed by cache path. Held while running ffprobe and writing the cache file, so that
+        // captures in the same process that open the same video at the same time only run
+        // ffprobe once and do not write the same temporary file.
+        std::unordered_map<std::string, std::shared_ptr<std::mutex>> loadMutexes;
+
+
+        // memoryCacheMutex must be held.
+        std::shared_ptr<const KeyFrameIndex::KeyFrames> FindInMemoryCache(const std::string &videoPath,
+                                                                          const FileVersion &version) {
+            auto iter = memoryCache.find(videoPath);
+            if (iter == memoryCache.end() || !(iter->second.version == version)) {
+                return nullptr;
+            }
+            iter->second.lastUse = ++memoryCacheUseCount;
+            return iter->second.keyFrames;
+        }
+
+
+        // memoryCacheMutex must be held.
+        void AddToMemoryCache(const std::string &videoPath, const FileVersion &version,
+                              std::shared_ptr<const KeyFrameIndex::KeyFrames> keyFrames) {
+            if (memoryCache.size() >= MAX_MEMORY_CACHE_ENTRIES
+                    && memoryCache.find(videoPath) == memoryCache.end()) {
+                auto leastRecentlyUsed = std::min_element(
+                        memoryCache.begin(), memoryCache.end(), [](const auto &e1, const auto &e2) {
+                            return e1.second.lastUse < e2.second.lastUse;
+                        });
+                memoryCache.erase(leastRecentlyUsed);
+            }
+            memoryCache[videoPath] = { version, std::move(keyFrames), ++memoryCacheUseCount };
+        }
+    }
+
+
+
+    std::shared_ptr<const std::vector<int>> KeyFrameIndex::Get(const std::string &videoPath,
+                                                               bool useDiskCache) {
+        auto keyFrames = GetWithTimes(videoPath, useDiskCache);
+        return { keyFrames, &keyFrames->frameNumbers };
+    }
+
+
+    std::shared_ptr<const KeyFrameIndex::KeyFrames> KeyFrameIndex::GetWithTimes(
+            const std::string &videoPath, bool useDiskCache) {
+        std::optional<FileVersion> version = GetFileVersion(videoPath);
+        if (!version) {
+            return std::make_shared<const KeyFrames>(ReadFromContainer(videoPath));
+        }
+
+        std::string cachePath = GetCachePath(videoPath);
+        std::shared_ptr<std::mutex> loadMutex;
+        {
+            std::lock_guard<std::mutex> lock(memoryCacheMutex);
+            if (auto keyFrames = FindInMemoryCache(videoPath, *version)) {
+                return keyFrames;
+            }
+            auto &mutexRef = loadMutexes[cachePath];
+            if (!mutexRef) {
+                mutexRef = std::make_shared<std::mutex>();
+            }
+            loadMutex = mutexRef;
+        }
+
+        std::shared_ptr<const KeyFrames> sharedKeyFrames;
+        {
+            std::lock_guard<std::mutex> loadLock(*loadMutex);
+            {
+                // Another thread may have loaded the index while this one was waiting.
+                std::lock_guard<std::mutex> lock(memoryCacheMutex);
+                sharedKeyFrames = FindInMemoryCache(videoPath, *version);
+            }
+            if (!sharedKeyFrames) {
+                std::optional<KeyFrames> keyFrames;
+                if (useDiskCache) {
+                    keyFrames = ReadDiskCache(cachePath, *version);
+                }
+                if (!keyFrames) {
+                    keyFrames = ReadFromContainer(videoPath);
+                    if (useDiskCache) {
+                        WriteDiskCache(cachePath, *version, *keyFrames);
+                    }
+                }
+                sharedKeyFrames = std::make_shared<const KeyFrames>(std::move(*keyFrames));
+                std::lock_guard<std::mutex> lock(memoryCacheMutex);
+                AddToMemoryCache(videoPath, *version, sharedKeyFrames);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(memoryCacheMutex);
+        // New references to loadMutex are only made while holding memoryCacheMutex, so when the
+        // map and this function hold the only references no other thread is using it.
+        auto loadMutexIter = loadMutexes.find(cachePath);
+        if (loadMutexIter != loadMutexes.end() && loadMutexIter->second == loadMutex
+                && loadMutex.use_count() == 2) {
+            loadMutexes.erase(loadMutexIter);
+        }
+        return sharedKeyFrames;
+    }
+
+
+    std::string KeyFrameIndex::GetCachePath(const std::string &videoPath) {
+        std::filesystem::path path(videoPath);
+        std::string cacheFileName = '.' + path.filename().string() + ".keyframes";
+        return (path.parent_path() / cacheFileName).string();
+    }
+
+
+    void KeyFrameIndex::ClearMemoryCache() {
+        std::lock_guard<std::mutex> lock(memoryCacheMutex);
+        memoryCache.clear();
+    }
+
+
+    KeyFrameIndex::KeyFrames KeyFrameIndex::ReadFromContainer(const std::string &videoPath) {
+        // -show_packets only demuxes the video, unlike -show_frames which decodes every frame.
+        std::string command =
+                "ffprobe -loglevel warning -select_streams v:0 -show_entries packet=pts_time,dts_time,flags -print_format csv=p=0 '"
+                + videoPath + "'";
+        FILE *pipe = popen(command.c_str(), "r");
+        if (pipe == nullptr) {
+            throw std::runtime_error("Unable to get key frames because ffprobe process failed to start.");
+        }
+
+        std::stringstream ffprobeOutput;
+        char lineBuf[128];
+        while (fgets(lineBuf, sizeof(lineBuf), pipe) != nullptr) {
+            ffprobeOutput << lineBuf;
+        }
+
+        int returnCode = pclose(pipe);
+        if (returnCode != 0) {
+            std::stringstream errorMsg;
+            errorMsg << "Unable to get key frames because the ffprobe process ";
+
+            if (WIFEXITED(returnCode)) {
+                int ffprobeExitStatus = WEXITSTATUS(returnCode);
+                errorMsg << "exited with exit code: " << ffprobeExitStatus;
+            }
+            else {
+                errorMsg << "did not exit normally";
+            }
+
+            if (WIFSIGNALED(returnCode)) {
+                errorMsg << " due to signal number: " << WTERMSIG(returnCode);
+            }
+            errorMsg << '.';
+
+            throw std::runtime_error(errorMsg.str());
+        }
+
+        return ParsePackets(ffprobeOutput);
+    }
+
+
+    KeyFrameIndex::KeyFrames KeyFrameIndex::ParsePackets(std::istream &ffprobeOutput) {
+        // Packets are in decode order, but frame numbers are in presentation order, so the
+        // packets are sorted by presentation timestamp before numbering them.
+        std::vector<std::pair<double, bool>> packets;
+        std::string lineText;
+        while (std::getline(ffprobeOutput, lineText)) {
+            // Expected line format: <pts_time>,<dts_time>,<flags>  For example: 0.080000,0.040000,K__
+            std::stringstream line(lineText);
+            std::string ptsField;
+            std::string dtsField;
+            std::string flags;
+            if (!std::getline(line, ptsField, ',') || !std::getline(line, dtsField, ',')
+                    || !std::getline(line, flags)) {
+                continue;
+            }
+            // The decoder drops packets marked as discard, such as the packets before the start
+            // of an MP4 edit list, so they must not be counted as frames.
+            if (flags.find('D') != std::string::npos) {
+                continue;
+            }
+
+            std::optional<double> timestamp = ParseTime(ptsField);
+            if (!timestamp) {
+                timestamp = ParseTime(dtsField);
+            }
+            if (!timestamp) {
+                // Assume the packet is presented right after the previous one. The stable sort
+                // below keeps it after the previous packet.
+                timestamp = packets.empty() ? 0 : packets.back().first;
+            }
+            packets.emplace_back(*timestamp, flags.find('K') != std::string::npos);
+        }
+
+        std::stable_sort(packets.begin(), packets.end(), [](const auto &p1, const auto &p2) {
+            return p1.first < p2.first;
+        });
+        // OpenCV reports times relative to the start of the stream.
+        double startTime = packets.empty() ? 0 : packets.front().first;
+        KeyFrames keyFrames;
+        for (int frameNumber = 0; frameNumber < static_cast<int>(packets.size()); frameNumber++) {
+            if (packets[frameNumber].second) {
+                keyFrames.frameNumbers.push_back(frameNumber);
+                keyFrames.timesInMillis.push_back((packets[frameNumber].first - startTime) * 1000);
+            }
+        }
+        keyFrames.frameNumbers.shrink_to_fit();
+        keyFrames.timesInMillis.shrink_to_fit();
+        return keyFrames;
+    }
+}}
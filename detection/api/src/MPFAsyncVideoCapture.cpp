@@ -26,7 +26,17 @@
 
 #include "MPFAsyncVideoCapture.h"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "detectionComponentUtils.h"
 
@@ -44,14 +54,265 @@ namespace MPF::COMPONENT {
 
     namespace {
 
-        void frameReader(MPFVideoCapture videoCapture,
-                         BlockingQueue<std::optional<MPFFrame>> &queue) {
+        using Clock = std::chrono::steady_clock;
+
+        std::int64_t nanosSince(Clock::time_point start) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+                    .count();
+        }
+
+
+        // Adjusts the frame queue's capacity based on how long each side of the queue waited
+        // during the last WINDOW_SIZE frames.
+        class CapacityTuner {
+        public:
+            CapacityTuner(BlockingQueue<std::optional<MPFFrame>> &queue, std::atomic<int> &capacity, std::atomic<int> &peakCapacity,
+                          const std::atomic<std::int64_t> &producerStallNanos,
+                          const std::atomic<std::int64_t> &consumerStallNanos,
+                          std::int64_t maxBytes)
+                    : queue_(queue)
+                    , capacity_(capacity)
+                    , peakCapacity_(peakCapacity)
+                    , producerStallNanos_(producerStallNanos)
+                    , consumerStallNanos_(consumerStallNanos)
+                    , maxBytes_(maxBytes) {
+                StartWindow();
+            }
+
+            void FrameQueued(std::int64_t frameBytes) {
+                framesInWindow_++;
+                if (framesInWindow_ < WINDOW_SIZE) {
+                    return;
+                }
+
+                auto windowNanos = nanosSince(windowStart_);
+                auto producerStall = producerStallNanos_.load() - windowProducerStart_;
+                auto consumerStall = consumerStallNanos_.load() - windowConsumerStart_;
+                // Stalls shorter than 5% of the window are ignored.
+                auto threshold = windowNanos / 20;
+
+                int maxCapacity = static_cast<int>(std::clamp<std::int64_t>(
+                        maxBytes_ / std::max<std::int64_t>(1, frameBytes), 1, INT_MAX));
+
+                int capacity = capacity_.load();
+                int newCapacity = std::min(capacity, maxCapacity);
+                if (producerStall > threshold && consumerStall > threshold) {
+                    // The queue fills up and then drains, so a deeper queue would absorb the
+                    // difference in speed between decoding and processing.
+                    newCapacity = std::min(maxCapacity, capacity * 2);
+                }
+                else if (producerStall > threshold) {
+                    // The consumer is always slower, so the queue stays full. Extra frames in the
+                    // queue only use memory.
+                    newCapacity = std::max(1, newCapacity - 1);
+                }
+
+                if (newCapacity != capacity) {
+                    queue_.set_max_size(newCapacity);
+                    capacity_ = newCapacity;
+                    if (newCapacity > peakCapacity_) {
+                        peakCapacity_ = newCapacity;
+                    }
+                }
+                StartWindow();
+            }
+
+        private:
+            static constexpr int WINDOW_SIZE = 16;
+
+            BlockingQueue<std::optional<MPFFrame>> &queue_;
+            std::atomic<int> &capacity_;
+            std::atomic<int> &peakCapacity_;
+            const std::atomic<std::int64_t> &producerStallNanos_;
+            const std::atomic<std::int64_t> &consumerStallNanos_;
+            std::int64_t maxBytes_;
+
+            int framesInWindow_ = 0;
+            Clock::time_point windowStart_;
+            std::int64_t windowProducerStart_ = 0;
+            std::int64_t windowConsumerStart_ = 0;
+
+            void StartWindow() {
+                framesInWindow_ = 0;
+                windowStart_ = Clock::now();
+                windowProducerStart_ = producerStallNanos_.load();
+                windowConsumerStart_ = consumerStallNanos_.load();
+            }
+        };
+
+
+        // Decodes frames on one thread and applies the frame transformers on a pool of threads.
+        // Read returns the transformed frames in their original order.
+        class TransformPool {
+        public:
+            TransformPool(MPFVideoCapture videoCapture, int threadCount)
+                    : frameTransformer_(videoCapture.GetFrameTransformer())
+                    , decodedFrames_(threadCount)
+                    , nextFrameIndex_(videoCapture.GetCurrentFramePosition())
+                    // Limits how far ahead of the oldest frame that has not been read the
+                    // transform threads can get.
+                    , reorderWindow_(2 * threadCount)
+                    , runningWorkerCount_(threadCount) {
+                decoder_ = std::async(std::launch::async, &TransformPool::Decode, this,
+                                      std::move(videoCapture));
+                for (int i = 0; i < threadCount; i++) {
+                    workers_.push_back(std::async(std::launch::async,
+                                                  &TransformPool::TransformFrames, this));
+                }
+            }
+
+            TransformPool(const TransformPool&) = delete;
+            TransformPool& operator=(const TransformPool&) = delete;
+
+            ~TransformPool() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    halted_ = true;
+                }
+                frameChanged_.notify_all();
+                decodedFrames_.halt();
+                // The std::future destructors wait for the threads to exit.
+            }
+
+            int GetCurrentFramePosition() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return nextFrameIndex_;
+            }
+
+            bool Read(cv::Mat &frame) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                // When there is an error, the frames that were transformed before the error are
+                // returned before the exception is re-thrown.
+                frameChanged_.wait(lock, [this] {
+                    return runningWorkerCount_ == 0
+                           || transformedFrames_.count(nextFrameIndex_) > 0;
+                });
+
+                auto frameIter = transformedFrames_.find(nextFrameIndex_);
+                if (frameIter != transformedFrames_.end()) {
+                    frame = std::move(frameIter->second);
+                    transformedFrames_.erase(frameIter);
+                    nextFrameIndex_++;
+                    lock.unlock();
+                    frameChanged_.notify_all();
+                    return true;
+                }
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                return false;
+            }
+
+        private:
+            std::shared_ptr<const IFrameTransformer> frameTransformer_;
+
+            BlockingQueue<MPFFrame> decodedFrames_;
+
+            std::mutex mutex_;
+            std::condition_variable frameChanged_;
+            std::map<int, cv::Mat> transformedFrames_;
+            int nextFrameIndex_;
+            int reorderWindow_;
+            int runningWorkerCount_;
+            bool halted_ = false;
+            std::exception_ptr error_;
+            // Index of the earliest frame that could not be transformed.
+            int failedFrameIndex_ = INT_MAX;
+
+            std::future<void> decoder_;
+            std::vector<std::future<void>> workers_;
+
+            void Decode(MPFVideoCapture videoCapture) {
+                try {
+                    while (true) {
+                        int frameIndex = videoCapture.GetCurrentFramePosition();
+                        cv::Mat frame;
+                        if (!videoCapture.ReadWithoutTransform(frame)) {
+                            break;
+                        }
+                        decodedFrames_.emplace(frameIndex, std::move(frame));
+                    }
+                }
+                catch (const QueueHaltedException&) {
+                    return;
+                }
+                catch (...) {
+                    SetError(std::current_exception());
+                }
+                // Lets the transform threads finish the frames that were already decoded.
+                decodedFrames_.complete_adding();
+            }
+
+            void TransformFrames() {
+                int frameIndex = -1;
+                try {
+                    while (true) {
+                        MPFFrame frame = decodedFrames_.pop();
+                        frameIndex = frame.index;
+                        frameTransformer_->TransformFrame(frame.data, frame.index);
+
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        frameChanged_.wait(lock, [this, &frame] {
+                            return halted_ || frame.index > failedFrameIndex_
+                                   || frame.index < nextFrameIndex_ + reorderWindow_;
+                        });
+                        if (halted_ || frame.index > failedFrameIndex_) {
+                            // The frames before this one will never all be read.
+                            break;
+                        }
+                        transformedFrames_.emplace(frame.index, std::move(frame.data));
+                        lock.unlock();
+                        frameChanged_.notify_all();
+                    }
+                }
+                catch (const QueueHaltedException&) {
+                    // All of the decoded frames have been transformed.
+                }
+                catch (...) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        failedFrameIndex_ = std::min(failedFrameIndex_, frameIndex);
+                    }
+                    SetError(std::current_exception());
+                    // The frames still in the queue come after the failed frame.
+                    decodedFrames_.halt();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    runningWorkerCount_--;
+                }
+                frameChanged_.notify_all();
+            }
+
+            void SetError(std::exception_ptr error) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!error_) {
+                        error_ = std::move(error);
+                    }
+                }
+                frameChanged_.notify_all();
+            }
+        };
+
+
+        template <typename FrameSource, typename Queue>
+        void readFrames(FrameSource &frameSource, Queue &queue,
+                        std::optional<CapacityTuner> &capacityTuner,
+                        std::atomic<std::int64_t> &producerStallNanos) {
             try {
                 while (true) {
-                    int frameIndex = videoCapture.GetCurrentFramePosition();
+                    int frameIndex = frameSource.GetCurrentFramePosition();
                     cv::Mat frameData;
-                    if (videoCapture.Read(frameData)) {
+                    if (frameSource.Read(frameData)) {
+                        std::int64_t frameBytes = frameData.total() * frameData.elemSize();
+                        auto pushStart = Clock::now();
                         queue.emplace(MPFFrame(frameIndex, std::move(frameData)));
+                        producerStallNanos += nanosSince(pushStart);
+                        if (capacityTuner) {
+                            capacityTuner->FrameQueued(frameBytes);
+                        }
                     }
                     else {
                         // Add empty optional to indicate that the end of the video has been reached.
@@ -78,6 +339,20 @@ namespace MPF::COMPONENT {
                 throw;
             }
         }
+
+
+        template <typename Queue>
+        void frameReader(MPFVideoCapture videoCapture, Queue &queue,
+                         std::optional<CapacityTuner> capacityTuner,
+                         std::atomic<std::int64_t> &producerStallNanos, int transformThreadCount) {
+            if (transformThreadCount > 0) {
+                TransformPool transformPool(std::move(videoCapture), transformThreadCount);
+                readFrames(transformPool, queue, capacityTuner, producerStallNanos);
+            }
+            else {
+                readFrames(videoCapture, queue, capacityTuner, producerStallNanos);
+            }
+        }
     }
 
 
@@ -87,38 +362,114 @@ namespace MPF::COMPONENT {
                                                bool enableFrameFiltering)
             : MPFAsyncVideoCapture(
                     MPFVideoCapture(videoJob, enableFrameTransformers, enableFrameFiltering),
-                    GetProperty(videoJob.job_properties, "FRAME_QUEUE_CAPACITY", 4))
+                    videoJob)
     {
     }
 
 
-    MPFAsyncVideoCapture::MPFAsyncVideoCapture(std::string videoPath, int frameQueueSize)
-            : MPFAsyncVideoCapture(MPFVideoCapture(std::move(videoPath)), frameQueueSize) {
+    MPFAsyncVideoCapture::MPFAsyncVideoCapture(MPFVideoCapture &&videoCapture,
+                                               const MPFVideoJob &videoJob)
+            : MPFAsyncVideoCapture(std::move(videoCapture),
+                                   GetFrameQueueConfig(videoJob, videoCapture.GetFrameSize()))
+    {
     }
 
 
-    MPFAsyncVideoCapture::MPFAsyncVideoCapture(MPFVideoCapture &&videoCapture, int frameQueueSize)
-            : frameQueue_(frameQueueSize)
+    MPFAsyncVideoCapture::MPFAsyncVideoCapture(std::string videoPath, int frameQueueSize,
+                                               bool useLockFreeQueue)
+            : MPFAsyncVideoCapture(MPFVideoCapture(std::move(videoPath)),
+                                   FrameQueueConfig{ frameQueueSize, useLockFreeQueue, 0, 0 }) {
+    }
+
+
+    MPFAsyncVideoCapture::MPFAsyncVideoCapture(MPFVideoCapture &&videoCapture,
+                                               const FrameQueueConfig &config)
+            : frameQueue_(CreateFrameQueue(config))
+            , frameQueueStats_(config.capacity)
             , frameCount_ (videoCapture.GetFrameCount())
             , frameRate_(videoCapture.GetFrameRate())
             , frameSize_(videoCapture.GetFrameSize())
             , originalFrameSize_(videoCapture.GetOriginalFrameSize())
             , reverseTransformer_(videoCapture.GetReverseTransformer())
-            , doneReadingFuture_(std::async(
-                    std::launch::async,
-                    frameReader, std::move(videoCapture), std::ref(frameQueue_)))
+            , doneReadingFuture_(StartFrameReader(std::move(videoCapture), frameQueue_,
+                                                  frameQueueStats_, config))
     {
     }
 
 
+    MPFAsyncVideoCapture::FrameQueueStats::FrameQueueStats(int capacity)
+            : capacity(capacity)
+            , peakCapacity(capacity) {
+    }
+
+
+    MPFAsyncVideoCapture::FrameQueueConfig MPFAsyncVideoCapture::GetFrameQueueConfig(
+            const MPFVideoJob &videoJob, const cv::Size &frameSize) {
+        const auto &props = videoJob.job_properties;
+        FrameQueueConfig config {
+            GetProperty(props, "FRAME_QUEUE_CAPACITY", 4),
+            GetProperty(props, "USE_LOCK_FREE_FRAME_QUEUE", false),
+            0,
+            std::max(0, GetProperty(props, "TRANSFORM_THREADS", 0))
+        };
+        if (GetProperty(props, "ADAPTIVE_FRAME_QUEUE_CAPACITY", false)) {
+            // An unbounded queue could not be kept within the memory budget.
+            config.capacity = std::max(1, config.capacity);
+            config.adaptiveMaxBytes = std::max<std::int64_t>(
+                    1, GetProperty<std::int64_t>(props, "FRAME_QUEUE_MAX_BYTES", 512 * 1024 * 1024));
+            // CapacityTuner only runs every few frames, so the initial capacity must already fit
+            // in the memory budget. Decoded frames have 3 channels.
+            std::int64_t frameBytes = std::max<std::int64_t>(
+                    1, static_cast<std::int64_t>(frameSize.area()) * 3);
+            config.capacity = static_cast<int>(std::clamp<std::int64_t>(
+                    config.adaptiveMaxBytes / frameBytes, 1, config.capacity));
+        }
+        return config;
+    }
+
+
+    MPFAsyncVideoCapture::FrameQueue MPFAsyncVideoCapture::CreateFrameQueue(
+            const FrameQueueConfig &config) {
+        // The queues can not be moved, so they must be constructed in place.
+        if (config.useLockFreeQueue && config.adaptiveMaxBytes <= 0) {
+            return FrameQueue(std::in_place_index<1>, config.capacity);
+        }
+        return FrameQueue(std::in_place_index<0>, config.capacity);
+    }
+
+
+    std::shared_future<void> MPFAsyncVideoCapture::StartFrameReader(MPFVideoCapture &&videoCapture,
+                                                                    FrameQueue &frameQueue,
+                                                                    FrameQueueStats &stats,
+                                                                    const FrameQueueConfig &config) {
+        return std::visit([&](auto &queue) {
+            using Queue = std::decay_t<decltype(queue)>;
+            std::optional<CapacityTuner> capacityTuner;
+            if constexpr (std::is_same_v<Queue, BlockingQueue<std::optional<MPFFrame>>>) {
+                if (config.adaptiveMaxBytes > 0) {
+                    capacityTuner.emplace(queue, stats.capacity, stats.peakCapacity,
+                                          stats.producerStallNanos, stats.consumerStallNanos,
+                                          config.adaptiveMaxBytes);
+                }
+            }
+            return std::async(std::launch::async, frameReader<Queue>,
+                              std::move(videoCapture), std::ref(queue), std::move(capacityTuner),
+                              std::ref(stats.producerStallNanos),
+                              config.transformThreadCount).share();
+        }, frameQueue);
+    }
+
+
     MPFAsyncVideoCapture::~MPFAsyncVideoCapture() {
-        frameQueue_.halt();
+        std::visit([](auto &queue) { queue.halt(); }, frameQueue_);
     }
 
 
     std::optional<MPFFrame> MPFAsyncVideoCapture::Read() {
         try {
-            auto frame = frameQueue_.pop();
+            auto popStart = Clock::now();
+            auto frame = std::visit([](auto &queue) { return queue.pop(); }, frameQueue_);
+            frameQueueStats_.consumerStallNanos += nanosSince(popStart);
             if (!frame) {
                 // If frameReader ended with an exception it will be re-thrown here.
                 doneReadingFuture_.get();
@@ -133,10 +484,43 @@ namespace MPF::COMPONENT {
     }
 
 
+    std::vector<MPFFrame> MPFAsyncVideoCapture::ReadBatch(int maxFrames) {
+        std::vector<std::optional<MPFFrame>> queuedFrames;
+        try {
+            auto popStart = Clock::now();
+            std::visit([&queuedFrames, maxFrames](auto &queue) {
+                queue.pop_many(queuedFrames, std::max(1, maxFrames));
+            }, frameQueue_);
+            frameQueueStats_.consumerStallNanos += nanosSince(popStart);
+        }
+        catch (QueueHaltedException&) {
+            // If frameReader ended with an exception it will be re-thrown here.
+            doneReadingFuture_.get();
+            return {};
+        }
+
+        std::vector<MPFFrame> frames;
+        frames.reserve(queuedFrames.size());
+        for (auto &frame : queuedFrames) {
+            if (!frame) {
+                // If frameReader ended with an exception it will be re-thrown here.
+                doneReadingFuture_.get();
+                break;
+            }
+            frames.push_back(std::move(*frame));
+        }
+        return frames;
+    }
+
+
     void MPFAsyncVideoCapture::ReverseTransform(MPFVideoTrack &videoTrack) const {
         reverseTransformer_(videoTrack);
     }
 
+    int MPFAsyncVideoCapture::ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex) const {
+        return reverseTransformer_(imageLocation, segmentFrameIndex);
+    }
+
     ReverseTransformer MPFAsyncVideoCapture::GetReverseTransformer() const {
         return reverseTransformer_;
     }
@@ -156,4 +540,13 @@ namespace MPF::COMPONENT {
     cv::Size MPFAsyncVideoCapture::GetOriginalFrameSize() const {
         return originalFrameSize_;
     }
+
+    FrameQueueMetrics MPFAsyncVideoCapture::GetFrameQueueMetrics() const {
+        return {
+            frameQueueStats_.capacity.load(),
+            frameQueueStats_.peakCapacity.load(),
+            frameQueueStats_.producerStallNanos.load() / 1e9,
+            frameQueueStats_.consumerStallNanos.load() / 1e9
+        };
+    }
 }
@@ -29,6 +29,8 @@
 #include <cassert>
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <opencv2/imgproc.hpp>
 
@@ -138,4 +140,154 @@ namespace MPF { namespace COMPONENT {
     }
 
 
+
+
+    MPFRotatedRectBatch::MPFRotatedRectBatch(const std::vector<MPFRotatedRect> &rects) {
+        Reserve(rects.size());
+        for (const auto &rect : rects) {
+            Add(rect);
+        }
+    }
+
+
+    void MPFRotatedRectBatch::Add(const MPFRotatedRect &rect) {
+        x_.push_back(rect.x);
+        y_.push_back(rect.y);
+        width_.push_back(rect.width);
+        height_.push_back(rect.height);
+        if (DetectionComponentUtils::RotationAnglesEqual(rect.rotation, 0)) {
+            // Matches MPFRotatedRect::GetCorners, which treats angles close to 0 as unrotated.
+            cos_.push_back(1);
+            sin_.push_back(0);
+        }
+        else {
+            double radians = rect.rotation * CV_PI / 180;
+            cos_.push_back(std::cos(radians));
+            sin_.push_back(std::sin(radians));
+        }
+        flipSign_.push_back(rect.flip ? -1 : 1);
+    }
+
+
+    void MPFRotatedRectBatch::Reserve(std::size_t count) {
+        x_.reserve(count);
+        y_.reserve(count);
+        width_.reserve(count);
+        height_.reserve(count);
+        cos_.reserve(count);
+        sin_.reserve(count);
+        flipSign_.reserve(count);
+    }
+
+
+    std::size_t MPFRotatedRectBatch::Size() const {
+        return x_.size();
+    }
+
+
+    bool MPFRotatedRectBatch::Empty() const {
+        return x_.empty();
+    }
+
+
+    template<typename CornerFunc>
+    void MPFRotatedRectBatch::ForEachCorner(CornerFunc &&cornerFunc) const {
+        const std::size_t count = Size();
+        const double *xs = x_.data();
+        const double *ys = y_.data();
+        const double *widths = width_.data();
+        const double *heights = height_.data();
+        const double *coss = cos_.data();
+        const double *sins = sin_.data();
+        const double *flipSigns = flipSign_.data();
+
+        for (std::size_t i = 0; i < count; i++) {
+            // Same as MPFRotatedRect::GetTransformMat, but expanded. Rotating counter-clockwise
+            // around the top left corner maps an offset (dx, dy) from the top left corner to
+            // (cos * dx + sin * dy, -sin * dx + cos * dy). Flipping around the top left corner
+            // then negates the x offset.
+            double right = widths[i] - 1;
+            double bottom = heights[i] - 1;
+            double cos = coss[i];
+            double sin = sins[i];
+            double flipSign = flipSigns[i];
+
+            double topRightX = xs[i] + flipSign * (cos * right);
+            double topRightY = ys[i] - sin * right;
+            double bottomRightX = xs[i] + flipSign * (cos * right + sin * bottom);
+            double bottomRightY = ys[i] - sin * right + cos * bottom;
+            double bottomLeftX = xs[i] + flipSign * (sin * bottom);
+            double bottomLeftY = ys[i] + cos * bottom;
+
+            cornerFunc(i, xs[i], ys[i], topRightX, topRightY, bottomRightX, bottomRightY,
+                       bottomLeftX, bottomLeftY);
+        }
+    }
+
+
+    std::vector<cv::Point2d> MPFRotatedRectBatch::GetCorners() const {
+        std::vector<cv::Point2d> corners(4 * Size());
+        ForEachCorner([&corners](std::size_t i, double x0, double y0, double x1, double y1,
+                                 double x2, double y2, double x3, double y3) {
+            cv::Point2d *rectCorners = &corners[4 * i];
+            rectCorners[0] = { x0, y0 };
+            rectCorners[1] = { x1, y1 };
+            rectCorners[2] = { x2, y2 };
+            rectCorners[3] = { x3, y3 };
+        });
+        return corners;
+    }
+
+
+    std::vector<cv::Rect2d> MPFRotatedRectBatch::GetBoundingRects() const {
+        std::vector<cv::Rect2d> boundingRects(Size());
+        ForEachCorner([&boundingRects](std::size_t i, double x0, double y0, double x1, double y1,
+                                       double x2, double y2, double x3, double y3) {
+            double minX = std::min(std::min(x0, x1), std::min(x2, x3));
+            double maxX = std::max(std::max(x0, x1), std::max(x2, x3));
+            double minY = std::min(std::min(y0, y1), std::min(y2, y3));
+            double maxY = std::max(std::max(y0, y1), std::max(y2, y3));
+            boundingRects[i] = cv::Rect2d(cv::Point2d(minX, minY),
+                                          cv::Point2d(maxX + 1, maxY + 1));
+        });
+        return boundingRects;
+    }
+
+
+    cv::Rect2d MPFRotatedRectBatch::GetBoundingRect() const {
+        return GetMappedBoundingRect(cv::Matx22d::eye());
+    }
+
+
+    cv::Rect2d MPFRotatedRectBatch::GetMappedBoundingRect(const cv::Matx22d &linearTransform) const {
+        if (Empty()) {
+            return {};
+        }
+        const double m00 = linearTransform(0, 0);
+        const double m01 = linearTransform(0, 1);
+        const double m10 = linearTransform(1, 0);
+        const double m11 = linearTransform(1, 1);
+
+        double minX = std::numeric_limits<double>::max();
+        double maxX = std::numeric_limits<double>::lowest();
+        double minY = std::numeric_limits<double>::max();
+        double maxY = std::numeric_limits<double>::lowest();
+        auto addCorner = [&](double x, double y) {
+            double mappedX = m00 * x + m01 * y;
+            double mappedY = m10 * x + m11 * y;
+            minX = std::min(minX, mappedX);
+            maxX = std::max(maxX, mappedX);
+            minY = std::min(minY, mappedY);
+            maxY = std::max(maxY, mappedY);
+        };
+
+        ForEachCorner([&addCorner](std::size_t, double x0, double y0, double x1, double y1,
+                                   double x2, double y2, double x3, double y3) {
+            addCorner(x0, y0);
+            addCorner(x1, y1);
+            addCorner(x2, y2);
+            addCorner(x3, y3);
+        });
+        return cv::Rect2d(cv::Point2d(minX, minY), cv::Point2d(maxX + 1, maxY + 1));
+    }
 }}
@@ -24,10 +24,14 @@
  * limitations under the License.                                             *
  ******************************************************************************/
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 #include "detectionComponentUtils.h"
 #include "FeedForwardFrameFilter.h"
@@ -49,10 +53,13 @@ namespace MPF { namespace COMPONENT {
     MPFVideoCapture::MPFVideoCapture(const MPFVideoJob &videoJob, bool enableFrameTransformers,
                                      bool enableFrameFiltering)
             : videoPath_(videoJob.data_uri)
-            , cvVideoCapture_(GetCvVideoCapture(videoJob.data_uri))
+            , decodeThreadCount_(GetDecodeThreadCount(videoJob))
+            , cvVideoCapture_(GetCvVideoCapture(videoJob.data_uri, decodeThreadCount_))
             , frameFilter_(GetFrameFilter(enableFrameFiltering, videoJob, cvVideoCapture_))
             , frameTransformer_(GetFrameTransformer(enableFrameTransformers, videoJob))
-            , seekStrategy_(GetSeekStrategy(videoJob)) {
+            , seekStrategy_(GetSeekStrategy(videoJob))
+            , seekStatistics_(CreateSeekStatistics(videoJob))
+            , framePool_(GetFramePool(videoJob)) {
 
         if (!cvVideoCapture_.isOpened()) {
             throw MPFDetectionException(MPFDetectionError::MPF_COULD_NOT_READ_MEDIA,
@@ -68,8 +75,22 @@ namespace MPF { namespace COMPONENT {
     }
 
 
-    cv::VideoCapture MPFVideoCapture::GetCvVideoCapture(const std::string &videoPath) {
-        cv::VideoCapture videoCapture(videoPath);
+    int MPFVideoCapture::GetDecodeThreadCount(const MPFVideoJob &job) {
+        return DetectionComponentUtils::GetProperty(job.job_properties, "DECODE_THREADS", -1);
+    }
+
+
+    cv::VideoCapture MPFVideoCapture::GetCvVideoCapture(const std::string &videoPath, int decodeThreadCount) {
+        cv::VideoCapture videoCapture;
+        if (decodeThreadCount < 0) {
+            videoCapture.open(videoPath);
+        }
+        else {
+            // The thread count can only be set when the video is opened. Only the FFmpeg backend
+            // supports CAP_PROP_N_THREADS, so other backends are not tried.
+            videoCapture.open(videoPath, cv::CAP_FFMPEG,
+                              { cv::CAP_PROP_N_THREADS, decodeThreadCount });
+        }
         videoCapture.set(cv::CAP_PROP_ORIENTATION_AUTO, 0);
         return videoCapture;
     }
@@ -130,9 +151,68 @@ namespace MPF { namespace COMPONENT {
     SeekStrategy::CPtr MPFVideoCapture::GetSeekStrategy(const MPFVideoJob &job) {
         bool hasConstantFrameRate = DetectionComponentUtils::GetProperty(
                 job.media_properties, "HAS_CONSTANT_FRAME_RATE", false);
-        return hasConstantFrameRate
-            ? SeekStrategy::CPtr(new SetFramePositionSeek)
-            : SeekStrategy::CPtr(new GrabSeek);
+        bool useIndexedSeek = DetectionComponentUtils::GetProperty(
+                job.job_properties, "USE_INDEXED_SEEK", true);
+        if (!useIndexedSeek) {
+            return hasConstantFrameRate
+                ? SeekStrategy::CPtr(new SetFramePositionSeek(GetSeekCostModel(job)))
+                : SeekStrategy::CPtr(new GrabSeek);
+        }
+
+        bool useDiskCache = DetectionComponentUtils::GetProperty(
+                job.job_properties, "KEY_FRAME_INDEX_DISK_CACHE", true);
+        auto keyFrameIndex = std::make_shared<const LazyKeyFrameIndex>(job.data_uri, useDiskCache);
+        if (!hasConstantFrameRate) {
+            return SeekStrategy::CPtr(new IndexedSeek(std::move(keyFrameIndex)));
+        }
+
+        // When the frame interval is longer than the distance between key frames, setting the
+        // frame position decodes fewer frames than grabbing through the skipped frames.
+        int frameInterval = DetectionComponentUtils::GetProperty(job.job_properties, "FRAME_INTERVAL", 1);
+        bool planWithKeyFrames = frameInterval > 1 && DetectionComponentUtils::GetProperty(
+                job.job_properties, "SPARSE_INTERVAL_DECODE", true);
+        return SeekStrategy::CPtr(new SetFramePositionSeek(
+                GetSeekCostModel(job), std::move(keyFrameIndex), planWithKeyFrames));
+    }
+
+
+    std::shared_ptr<SeekCostModel> MPFVideoCapture::GetSeekCostModel(const MPFVideoJob &job) {
+        if (DetectionComponentUtils::GetProperty(job.job_properties, "USE_SEEK_COST_MODEL", true)) {
+            return SeekCostModel::GetForVideo(job.data_uri);
+        }
+        return nullptr;
+    }
+
+
+    std::shared_ptr<SeekStatistics> MPFVideoCapture::CreateSeekStatistics(const MPFVideoJob &job) {
+        std::string outputPath = DetectionComponentUtils::GetProperty(
+                job.job_properties, "SEEK_STATISTICS_FILE", "");
+        if (outputPath.empty()) {
+            return std::make_shared<SeekStatistics>(job.data_uri);
+        }
+
+        // The statistics move with the capture, so they are written when the capture that ends up
+        // owning them is destroyed. Each capture appends one line, so that the decoders of a
+        // ParallelVideoCapture and later jobs can use the same file.
+        return {
+            new SeekStatistics(job.data_uri),
+            [outputPath](SeekStatistics *seekStatistics) {
+                std::ofstream outFile(outputPath, std::ios::app);
+                outFile << seekStatistics->ToJson() << '\n' << std::flush;
+                if (!outFile) {
+                    std::cerr << "Failed to write seek statistics to \"" << outputPath << '"' << std::endl;
+                }
+                delete seekStatistics;
+            }
+        };
+    }
+
+
+    FramePool* MPFVideoCapture::GetFramePool(const MPFVideoJob &job) {
+        if (DetectionComponentUtils::GetProperty(job.job_properties, "USE_FRAME_POOL", false)) {
+            return &FramePool::GetInstance();
+        }
+        return nullptr;
     }
 
 
@@ -176,7 +256,14 @@ namespace MPF { namespace COMPONENT {
             return false;
         }
 
+        auto start = std::chrono::steady_clock::now();
+        int startPosition = framePosition_;
         framePosition_ = seekStrategy_->ChangePosition(cvVideoCapture_, framePosition_, requestedOriginalPosition);
+        seekStatistics_->AddSeek({
+            seekStrategy_->GetName(), startPosition, requestedOriginalPosition, framePosition_,
+            seekStrategy_->GetFramesDecodedByLastSeek(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+        });
         if (framePosition_ == requestedOriginalPosition) {
             return true;
         }
@@ -190,51 +277,90 @@ namespace MPF { namespace COMPONENT {
             return false;
         }
 
+        std::string failedStrategy = seekStrategy_->GetName();
         seekStrategy_ = seekStrategy_->fallback();
+        seekStatistics_->AddFallback({ failedStrategy, seekStrategy_ ? seekStrategy_->GetName() : "" });
         if (!seekStrategy_) {
             return false;
         }
 
         framePosition_ = 0;
         cvVideoCapture_.release();
-        cvVideoCapture_ = cv::VideoCapture(videoPath_);
+        cvVideoCapture_ = GetCvVideoCapture(videoPath_, decodeThreadCount_);
         return cvVideoCapture_.isOpened();
     }
 
 
+    const SeekStatistics& MPFVideoCapture::GetSeekStatistics() const {
+        return *seekStatistics_;
+    }
+
+
     int MPFVideoCapture::GetCurrentFramePosition() const {
         return frameFilter_->OriginalToSegmentFramePosition(framePosition_);
     }
 
 
     bool MPFVideoCapture::Read(cv::Mat &frame) {
+        int segmentPosition = GetCurrentFramePosition();
+        if (ReadWithoutTransform(frame)) {
+            frameTransformer_->TransformFrame(frame, segmentPosition);
+            return true;
+        }
+        return false;
+    }
+
+
+    bool MPFVideoCapture::ReadWithoutTransform(cv::Mat &frame) {
         MPFBreaker::check();
-        int originalPosBeforeRead = framePosition_;
-        if (frameFilter_->IsPastEndOfSegment(originalPosBeforeRead)) {
+        if (frameFilter_->IsPastEndOfSegment(framePosition_)) {
             frame.release();
             return false;
         }
+        return ReadAndMoveToNextFrame(frame);
+    }
 
-        bool wasRead = ReadAndTransform(frame);
-        if (wasRead) {
-            MoveToNextFrameInSegment();
-            return true;
+
+    int MPFVideoCapture::ReadBatch(std::vector<cv::Mat> &frames, int maxFrames) {
+        MPFBreaker::check();
+        if (maxFrames < 1 || frameFilter_->IsPastEndOfSegment(framePosition_)) {
+            frames.clear();
+            return -1;
         }
 
-        if (SeekFallback() && UpdateOriginalFramePosition(originalPosBeforeRead)) {
-            return Read(frame);
+        int firstSegmentPosition = GetCurrentFramePosition();
+        int numFramesRemaining = frameFilter_->GetSegmentFrameCount() - firstSegmentPosition;
+        // Existing elements are kept so that their buffers can be reused when they are the right size.
+        frames.resize(std::min(maxFrames, numFramesRemaining));
+
+        size_t numFramesRead = 0;
+        while (numFramesRead < frames.size() && ReadAndMoveToNextFrame(frames[numFramesRead])) {
+            numFramesRead++;
         }
-        return false;
+        frames.resize(numFramesRead);
+        if (frames.empty()) {
+            return -1;
+        }
+
+        frameTransformer_->TransformFrames(frames, firstSegmentPosition);
+        return firstSegmentPosition;
     }
 
 
-    bool MPFVideoCapture::ReadAndTransform(cv::Mat &frame) {
-        bool wasRead = cvVideoCapture_.read(frame);
-        if (wasRead) {
-            frameTransformer_->TransformFrame(frame, GetCurrentFramePosition());
+    bool MPFVideoCapture::ReadAndMoveToNextFrame(cv::Mat &frame) {
+        int originalPosBeforeRead = framePosition_;
+        if (framePool_ != nullptr) {
+            framePool_->Use(frame);
+        }
+        if (cvVideoCapture_.read(frame)) {
             framePosition_++;
+            MoveToNextFrameInSegment();
+            return true;
         }
-        return wasRead;
+
+        return SeekFallback()
+                && UpdateOriginalFramePosition(originalPosBeforeRead)
+                && ReadAndMoveToNextFrame(frame);
     }
 
 
@@ -361,10 +487,25 @@ namespace MPF { namespace COMPONENT {
     }
 
 
+    int MPFVideoCapture::ReverseTransform(MPFImageLocation &imageLocation,
+                                          int segmentFrameIndex) const {
+        return ReverseTransformer::ReverseTransform(imageLocation, segmentFrameIndex,
+                                                    *frameTransformer_, *frameFilter_);
+    }
+
+
     ReverseTransformer MPFVideoCapture::GetReverseTransformer() const {
         return ReverseTransformer(frameTransformer_, frameFilter_);
     }
 
+    std::shared_ptr<const FrameFilter> MPFVideoCapture::GetFrameFilter() const {
+        return frameFilter_;
+    }
+
+    std::shared_ptr<const IFrameTransformer> MPFVideoCapture::GetFrameTransformer() const {
+        return frameTransformer_;
+    }
+
     std::vector<cv::Mat> MPFVideoCapture::GetInitializationFramesIfAvailable(int numberOfRequestedFrames) {
         int initFramesAvailable = frameFilter_->GetAvailableInitializationFrameCount();
         int numFramesToGet = std::min(initFramesAvailable, numberOfRequestedFrames);
@@ -410,20 +551,42 @@ namespace MPF { namespace COMPONENT {
         ReverseTransform(track, *frameTransformer_, *frameFilter_);
     }
 
+    int ReverseTransformer::operator()(MPFImageLocation &imageLocation, int segmentFrameIndex) const {
+        return ReverseTransform(imageLocation, segmentFrameIndex, *frameTransformer_, *frameFilter_);
+    }
+
     void ReverseTransformer::ReverseTransform(MPFVideoTrack &track,
                                               const IFrameTransformer &frameTransformer,
                                               const FrameFilter &frameFilter) {
         track.start_frame = frameFilter.SegmentToOriginalFramePosition(track.start_frame);
         track.stop_frame = frameFilter.SegmentToOriginalFramePosition(track.stop_frame);
 
-        std::map<int, MPFImageLocation> newFrameLocations;
+        std::vector<MPFImageLocation*> imageLocations;
+        std::vector<int> frameIndices;
+        imageLocations.reserve(track.frame_locations.size());
+        frameIndices.reserve(track.frame_locations.size());
         for (auto &frameLocationPair : track.frame_locations) {
-            frameTransformer.ReverseTransform(frameLocationPair.second, frameLocationPair.first);
+            frameIndices.push_back(frameLocationPair.first);
+            imageLocations.push_back(&frameLocationPair.second);
+        }
+        frameTransformer.ReverseTransformAll(imageLocations, frameIndices);
 
-            int fixedFrameIndex = frameFilter.SegmentToOriginalFramePosition(frameLocationPair.first);
-            newFrameLocations.emplace(fixedFrameIndex, std::move(frameLocationPair.second));
+        // Re-key the existing nodes instead of copying the detections in to a new map.
+        // SegmentToOriginalFramePosition preserves the order, so each node is inserted at the end.
+        std::map<int, MPFImageLocation> newFrameLocations;
+        while (!track.frame_locations.empty()) {
+            auto node = track.frame_locations.extract(track.frame_locations.begin());
+            node.key() = frameFilter.SegmentToOriginalFramePosition(node.key());
+            newFrameLocations.insert(newFrameLocations.end(), std::move(node));
         }
 
         track.frame_locations = std::move(newFrameLocations);
     }
+
+    int ReverseTransformer::ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex,
+                                             const IFrameTransformer &frameTransformer,
+                                             const FrameFilter &frameFilter) {
+        frameTransformer.ReverseTransform(imageLocation, segmentFrameIndex);
+        return frameFilter.SegmentToOriginalFramePosition(segmentFrameIndex);
+    }
 }}
@@ -0,0 +1,429 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "NonMaximumSuppression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include "detectionComponentUtils.h"
+
+
+namespace MPF { namespace COMPONENT {
+
+    namespace {
+        // Clipping a quadrilateral against another quadrilateral adds at most one vertex per edge.
+        constexpr int MAX_POLYGON_SIZE = 8;
+
+        struct Polygon {
+            std::array<cv::Point2d, MAX_POLYGON_SIZE> points;
+            int size = 0;
+        };
+
+
+        // Unlike MPFRotatedRect::GetCorners, the corners are on the outside edges of the pixels
+        // rather than at the pixel centers, so that an unrotated rectangle covers
+        // width * height pixels.
+        Polygon GetOuterCorners(const MPFRotatedRect &rect) {
+            double cos = 1;
+            double sin = 0;
+            if (!DetectionComponentUtils::RotationAnglesEqual(rect.rotation, 0)) {
+                double radians = rect.rotation * CV_PI / 180;
+                cos = std::cos(radians);
+                sin = std::sin(radians);
+            }
+            double flipSign = rect.flip ? -1 : 1;
+
+            Polygon corners;
+            corners.points[0] = { rect.x, rect.y };
+            corners.points[1] = { rect.x + flipSign * cos * rect.width,
+                                  rect.y - sin * rect.width };
+            corners.points[2] = { rect.x + flipSign * (cos * rect.width + sin * rect.height),
+                                  rect.y - sin * rect.width + cos * rect.height };
+            corners.points[3] = { rect.x + flipSign * sin * rect.height,
+                                  rect.y + cos * rect.height };
+            corners.size = 4;
+            return corners;
+        }
+
+
+        double Cross(const cv::Point2d &origin, const cv::Point2d &p1, const cv::Point2d &p2) {
+            return (p1 - origin).cross(p2 - origin);
+        }
+
+
+        double SignedArea(const Polygon &polygon) {
+            double twiceArea = 0;
+            for (int i = 0; i < polygon.size; i++) {
+                twiceArea += polygon.points[i].cross(polygon.points[(i + 1) % polygon.size]);
+            }
+            return twiceArea / 2;
+        }
+
+
+        // Sutherland-Hodgman clipping of subject against the convex polygon clip, which must have
+        // a positive signed area.
+        Polygon Clip(const Polygon &subject, const Polygon &clip) {
+            Polygon output = subject;
+            for (int edge = 0; edge < clip.size && output.size > 0; edge++) {
+                const cv::Point2d &edgeStart = clip.points[edge];
+                const cv::Point2d &edgeEnd = clip.points[(edge + 1) % clip.size];
+
+                Polygon input = output;
+                output.size = 0;
+                for (int i = 0; i < input.size; i++) {
+                    const cv::Point2d &current = input.points[i];
+                    const cv::Point2d &next = input.points[(i + 1) % input.size];
+                    double currentSide = Cross(edgeStart, edgeEnd, current);
+                    double nextSide = Cross(edgeStart, edgeEnd, next);
+
+                    if (currentSide >= 0 && output.size < MAX_POLYGON_SIZE) {
+                        output.points[output.size++] = current;
+                    }
+                    if ((currentSide >= 0) != (nextSide >= 0) && output.size < MAX_POLYGON_SIZE) {
+                        double t = currentSide / (currentSide - nextSide);
+                        output.points[output.size++] = current + t * (next - current);
+                    }
+                }
+            }
+            return output;
+        }
+
+
+        cv::Rect2d GetBoundingRect(const cv::Rect2d &rect) {
+            return rect;
+        }
+
+        cv::Rect2d GetBoundingRect(const MPFRotatedRect &rect) {
+            Polygon corners = GetOuterCorners(rect);
+            double minX = corners.points[0].x;
+            double maxX = minX;
+            double minY = corners.points[0].y;
+            double maxY = minY;
+            for (int i = 1; i < corners.size; i++) {
+                minX = std::min(minX, corners.points[i].x);
+                maxX = std::max(maxX, corners.points[i].x);
+                minY = std::min(minY, corners.points[i].y);
+                maxY = std::max(maxY, corners.points[i].y);
+            }
+            return { cv::Point2d(minX, minY), cv::Point2d(maxX, maxY) };
+        }
+
+
+        // Uniform grid over the boxes' bounding rects so that a box is only compared with the
+        // boxes in the cells it overlaps.
+        class UniformGrid {
+        public:
+            explicit UniformGrid(const std::vector<cv::Rect2d> &bounds)
+                : lastVisit_(bounds.size(), -1)
+            {
+                if (bounds.empty()) {
+                    return;
+                }
+                cv::Rect2d extent = bounds.front();
+                double sizeSum = 0;
+                for (const auto &rect : bounds) {
+                    extent |= rect;
+                    sizeSum += std::max(rect.width, rect.height);
+                }
+                origin_ = extent.tl();
+                cellSize_ = std::max(1.0, sizeSum / bounds.size());
+
+                // Limit the number of cells when the boxes are small and spread out.
+                std::size_t maxCells = std::max<std::size_t>(64, 4 * bounds.size());
+                while (true) {
+                    columns_ = static_cast<int>(extent.width / cellSize_) + 1;
+                    rows_ = static_cast<int>(extent.height / cellSize_) + 1;
+                    if (static_cast<std::size_t>(columns_) * rows_ <= maxCells) {
+                        break;
+                    }
+                    cellSize_ *= 2;
+                }
+                cells_.resize(static_cast<std::size_t>(columns_) * rows_);
+            }
+
+            void Insert(int index, const cv::Rect2d &rect) {
+                cv::Rect cellRange = GetCellRange(rect);
+                for (int row = cellRange.y; row < cellRange.y + cellRange.height; row++) {
+                    for (int col = cellRange.x; col < cellRange.x + cellRange.width; col++) {
+                        cells_[row * columns_ + col].push_back(index);
+                    }
+                }
+            }
+
+            // Calls visit once for each inserted index whose cells overlap rect. Stops early if
+            // visit returns true.
+            template<typename Visitor>
+            void ForEachCandidate(const cv::Rect2d &rect, Visitor &&visit) {
+                int queryId = queryCount_++;
+                cv::Rect cellRange = GetCellRange(rect);
+                for (int row = cellRange.y; row < cellRange.y + cellRange.height; row++) {
+                    for (int col = cellRange.x; col < cellRange.x + cellRange.width; col++) {
+                        for (int index : cells_[row * columns_ + col]) {
+                            if (lastVisit_[index] == queryId) {
+                                continue;
+                            }
+                            lastVisit_[index] = queryId;
+                            if (visit(index)) {
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+
+        private:
+            cv::Point2d origin_;
+            double cellSize_ = 1;
+            int columns_ = 0;
+            int rows_ = 0;
+            std::vector<std::vector<int>> cells_;
+            // Prevents an index in more than one cell from being visited more than once per query.
+            std::vector<int> lastVisit_;
+            int queryCount_ = 0;
+
+            int ToCell(double value, double origin, int cellCount) const {
+                int cell = static_cast<int>(std::floor((value - origin) / cellSize_));
+                return std::clamp(cell, 0, cellCount - 1);
+            }
+
+            cv::Rect GetCellRange(const cv::Rect2d &rect) const {
+                int firstCol = ToCell(rect.x, origin_.x, columns_);
+                int lastCol = ToCell(rect.x + rect.width, origin_.x, columns_);
+                int firstRow = ToCell(rect.y, origin_.y, rows_);
+                int lastRow = ToCell(rect.y + rect.height, origin_.y, rows_);
+                return { firstCol, firstRow, lastCol - firstCol + 1, lastRow - firstRow + 1 };
+            }
+        };
+
+
+        template<typename Box>
+        std::vector<cv::Rect2d> GetAllBoundingRects(const std::vector<Box> &boxes) {
+            std::vector<cv::Rect2d> bounds;
+            bounds.reserve(boxes.size());
+            for (const auto &box : boxes) {
+                bounds.push_back(GetBoundingRect(box));
+            }
+            return bounds;
+        }
+
+
+        void CheckScoreCount(std::size_t boxCount, std::size_t scoreCount) {
+            if (boxCount != scoreCount) {
+                throw std::invalid_argument(
+                        "Non-maximum suppression requires one score per box, but there were "
+                        + std::to_string(boxCount) + " boxes and " + std::to_string(scoreCount)
+                        + " scores.");
+            }
+        }
+
+
+        template<typename Box>
+        std::vector<int> HardNms(const std::vector<Box> &boxes, const std::vector<float> &scores,
+                                 double iouThreshold) {
+            CheckScoreCount(boxes.size(), scores.size());
+            std::vector<int> order(boxes.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&scores](int i1, int i2) {
+                return scores[i1] > scores[i2];
+            });
+
+            std::vector<cv::Rect2d> bounds = GetAllBoundingRects(boxes);
+            UniformGrid keptBoxes(bounds);
+            std::vector<int> kept;
+            for (int candidate : order) {
+                bool suppressed = false;
+                keptBoxes.ForEachCandidate(bounds[candidate], [&](int keptIndex) {
+                    suppressed = IntersectionOverUnion(boxes[candidate], boxes[keptIndex]) > iouThreshold;
+                    return suppressed;
+                });
+                if (!suppressed) {
+                    kept.push_back(candidate);
+                    keptBoxes.Insert(candidate, bounds[candidate]);
+                }
+            }
+            return kept;
+        }
+
+
+        template<typename Box>
+        std::vector<int> SoftNms(const std::vector<Box> &boxes, std::vector<float> &scores,
+                                 const SoftNmsSettings &settings) {
+            CheckScoreCount(boxes.size(), scores.size());
+            std::vector<cv::Rect2d> bounds = GetAllBoundingRects(boxes);
+            UniformGrid allBoxes(bounds);
+            for (int i = 0; i < static_cast<int>(boxes.size()); i++) {
+                allBoxes.Insert(i, bounds[i]);
+            }
+
+            // Entries become stale when a box's score decays. Stale entries are skipped when
+            // their score no longer matches the box's current score.
+            std::priority_queue<std::pair<float, int>> queue;
+            for (int i = 0; i < static_cast<int>(boxes.size()); i++) {
+                queue.emplace(scores[i], i);
+            }
+
+            std::vector<bool> selected(boxes.size(), false);
+            std::vector<int> kept;
+            while (!queue.empty()) {
+                auto [score, index] = queue.top();
+                queue.pop();
+                if (selected[index] || score != scores[index]) {
+                    continue;
+                }
+                if (score < settings.scoreThreshold) {
+                    // Every remaining box has a score less than or equal to this one.
+                    break;
+                }
+                selected[index] = true;
+                kept.push_back(index);
+
+                allBoxes.ForEachCandidate(bounds[index], [&](int other) {
+                    if (selected[other]) {
+                        return false;
+                    }
+                    double iou = IntersectionOverUnion(boxes[index], boxes[other]);
+                    double weight = 1;
+                    if (settings.decay == SoftNmsDecay::LINEAR) {
+                        if (iou > settings.iouThreshold) {
+                            weight = 1 - iou;
+                        }
+                    }
+                    else {
+                        weight = std::exp(-iou * iou / settings.sigma);
+                    }
+                    if (weight < 1) {
+                        scores[other] = static_cast<float>(scores[other] * weight);
+                        queue.emplace(scores[other], other);
+                    }
+                    return false;
+                });
+            }
+            return kept;
+        }
+    }
+
+
+
+    double IntersectionOverUnion(const cv::Rect2d &rect1, const cv::Rect2d &rect2) {
+        double intersection = (rect1 & rect2).area();
+        double unionArea = rect1.area() + rect2.area() - intersection;
+        return unionArea > 0 ? intersection / unionArea : 0;
+    }
+
+
+    double IntersectionOverUnion(const MPFRotatedRect &rect1, const MPFRotatedRect &rect2) {
+        bool isAxisAligned1 = !rect1.flip && DetectionComponentUtils::RotationAnglesEqual(rect1.rotation, 0);
+        bool isAxisAligned2 = !rect2.flip && DetectionComponentUtils::RotationAnglesEqual(rect2.rotation, 0);
+        if (isAxisAligned1 && isAxisAligned2) {
+            return IntersectionOverUnion(cv::Rect2d(rect1.x, rect1.y, rect1.width, rect1.height),
+                                         cv::Rect2d(rect2.x, rect2.y, rect2.width, rect2.height));
+        }
+
+        Polygon corners1 = GetOuterCorners(rect1);
+        Polygon corners2 = GetOuterCorners(rect2);
+        if (SignedArea(corners2) < 0) {
+            std::reverse(corners2.points.begin(), corners2.points.begin() + corners2.size);
+        }
+        double intersection = std::abs(SignedArea(Clip(corners1, corners2)));
+        double unionArea = rect1.width * rect1.height + rect2.width * rect2.height - intersection;
+        return unionArea > 0 ? intersection / unionArea : 0;
+    }
+
+
+    MPFRotatedRect ToRotatedRect(const MPFImageLocation &imageLocation) {
+        return {
+            static_cast<double>(imageLocation.x_left_upper),
+            static_cast<double>(imageLocation.y_left_upper),
+            static_cast<double>(imageLocation.width),
+            static_cast<double>(imageLocation.height),
+            DetectionComponentUtils::GetProperty(imageLocation.detection_properties, "ROTATION", 0.0),
+            DetectionComponentUtils::GetProperty(imageLocation.detection_properties, "HORIZONTAL_FLIP", false)
+        };
+    }
+
+
+    std::vector<int> NonMaximumSuppression(const std::vector<cv::Rect2d> &boxes,
+                                           const std::vector<float> &scores,
+                                           double iouThreshold) {
+        return HardNms(boxes, scores, iouThreshold);
+    }
+
+
+    std::vector<int> NonMaximumSuppression(const std::vector<MPFRotatedRect> &boxes,
+                                           const std::vector<float> &scores,
+                                           double iouThreshold) {
+        return HardNms(boxes, scores, iouThreshold);
+    }
+
+
+    void NonMaximumSuppression(std::vector<MPFImageLocation> &detections, double iouThreshold) {
+        std::vector<MPFRotatedRect> boxes;
+        std::vector<float> scores;
+        boxes.reserve(detections.size());
+        scores.reserve(detections.size());
+        for (const auto &detection : detections) {
+            boxes.push_back(ToRotatedRect(detection));
+            scores.push_back(detection.confidence);
+        }
+
+        std::vector<bool> keep(detections.size(), false);
+        for (int index : HardNms(boxes, scores, iouThreshold)) {
+            keep[index] = true;
+        }
+
+        std::size_t outIndex = 0;
+        for (std::size_t i = 0; i < detections.size(); i++) {
+            if (keep[i]) {
+                if (outIndex != i) {
+                    detections[outIndex] = std::move(detections[i]);
+                }
+                outIndex++;
+            }
+        }
+        detections.erase(detections.begin() + outIndex, detections.end());
+    }
+
+
+    std::vector<int> SoftNonMaximumSuppression(const std::vector<cv::Rect2d> &boxes,
+                                               std::vector<float> &scores,
+                                               const SoftNmsSettings &settings) {
+        return SoftNms(boxes, scores, settings);
+    }
+
+
+    std::vector<int> SoftNonMaximumSuppression(const std::vector<MPFRotatedRect> &boxes,
+                                               std::vector<float> &scores,
+                                               const SoftNmsSettings &settings) {
+        return SoftNms(boxes, scores, settings);
+    }
+}}
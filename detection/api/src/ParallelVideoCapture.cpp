@@ -0,0 +1,309 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "ParallelVideoCapture.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "detectionComponentUtils.h"
+#include "KeyFrameFilter.h"
+
+
+using DetectionComponentUtils::GetProperty;
+
+
+namespace MPF::COMPONENT {
+
+    namespace {
+        using FrameQueue = BlockingQueue<std::optional<MPFFrame>>;
+
+
+        bool decodeChunk(MPFVideoCapture &videoCapture, const std::pair<int, int> &chunk,
+                         FrameQueue &queue) {
+            if (!videoCapture.SetFramePosition(chunk.first)) {
+                return false;
+            }
+            for (int i = chunk.first; i <= chunk.second; i++) {
+                int frameIndex = videoCapture.GetCurrentFramePosition();
+                cv::Mat frameData;
+                if (!videoCapture.Read(frameData)) {
+                    return false;
+                }
+                queue.emplace(MPFFrame(frameIndex, std::move(frameData)));
+            }
+            return true;
+        }
+
+
+        void chunkDecoder(MPFVideoCapture videoCapture, std::vector<std::pair<int, int>> chunks,
+                          FrameQueue &queue) {
+            try {
+                for (const auto &chunk : chunks) {
+                    if (!decodeChunk(videoCapture, chunk, queue)) {
+                        break;
+                    }
+                }
+                // Add empty optional to indicate that the decoder will not produce any more frames.
+                queue.push(std::nullopt);
+                queue.complete_adding();
+            }
+            catch (const QueueHaltedException&) {
+                // Other side requested early exit.
+            }
+            catch (...) {
+                try {
+                    // Add empty optional to make sure other side doesn't get stuck if an exception
+                    // is thrown.
+                    queue.push(std::nullopt);
+                    queue.complete_adding();
+                }
+                catch (const QueueHaltedException&) {
+                    // This is very unlikely, but we don't want the QueueHaltedException to
+                    // hide the true exception;
+                }
+                throw;
+            }
+        }
+
+
+        // Returns the key frames in the original video that are within the segment.
+        std::vector<int> getKeyFrames(const MPFVideoJob &videoJob, const FrameFilter &frameFilter) {
+            int firstFrame = frameFilter.SegmentToOriginalFramePosition(0);
+            int lastFrame = frameFilter.SegmentToOriginalFramePosition(
+                    frameFilter.GetSegmentFrameCount() - 1);
+            try {
+                KeyFrameFilter keyFrameFilter(
+                        MPFVideoJob(videoJob.job_name, videoJob.data_uri, firstFrame, lastFrame, {}, {}));
+                std::vector<int> keyFrames;
+                keyFrames.reserve(keyFrameFilter.GetSegmentFrameCount());
+                for (int i = 0; i < keyFrameFilter.GetSegmentFrameCount(); i++) {
+                    keyFrames.push_back(keyFrameFilter.SegmentToOriginalFramePosition(i));
+                }
+                return keyFrames;
+            }
+            catch (const std::runtime_error &error) {
+                std::cerr << error.what() << std::endl;
+                std::cerr << "ParallelVideoCapture chunks will not be aligned to key frames." << std::endl;
+                return {};
+            }
+        }
+
+
+        // Returns the first segment position at or after the first key frame that is at or after
+        // segmentPosition.
+        int alignToKeyFrame(int segmentPosition, const std::vector<int> &keyFrames,
+                            const FrameFilter &frameFilter) {
+            int segmentFrameCount = frameFilter.GetSegmentFrameCount();
+            int originalPosition = frameFilter.SegmentToOriginalFramePosition(segmentPosition);
+            auto keyFrameIter = std::lower_bound(keyFrames.begin(), keyFrames.end(), originalPosition);
+            if (keyFrameIter == keyFrames.end()) {
+                return segmentFrameCount;
+            }
+
+            int alignedPosition = frameFilter.OriginalToSegmentFramePosition(*keyFrameIter);
+            if (alignedPosition < segmentFrameCount
+                    && frameFilter.SegmentToOriginalFramePosition(alignedPosition) < *keyFrameIter) {
+                alignedPosition++;
+            }
+            return std::max(segmentPosition, alignedPosition);
+        }
+    }
+
+
+
+    ParallelVideoCapture::ParallelVideoCapture(const MPFVideoJob &videoJob,
+                                               bool enableFrameTransformers,
+                                               bool enableFrameFiltering)
+            : ParallelVideoCapture(
+                    videoJob,
+                    MPFVideoCapture(videoJob, enableFrameTransformers, enableFrameFiltering),
+                    enableFrameTransformers, enableFrameFiltering)
+    {
+    }
+
+
+    ParallelVideoCapture::ParallelVideoCapture(const MPFVideoJob &videoJob,
+                                               MPFVideoCapture &&firstDecoder,
+                                               bool enableFrameTransformers,
+                                               bool enableFrameFiltering)
+            : frameCount_(firstDecoder.GetFrameCount())
+            , frameRate_(firstDecoder.GetFrameRate())
+            , frameSize_(firstDecoder.GetFrameSize())
+            , originalFrameSize_(firstDecoder.GetOriginalFrameSize())
+            , reverseTransformer_(firstDecoder.GetReverseTransformer())
+            , chunks_(CreateChunks(videoJob, *firstDecoder.GetFrameFilter(),
+                                   GetProperty(videoJob.job_properties, "PARALLEL_CHUNK_SIZE", 64)))
+    {
+        if (chunks_.empty()) {
+            return;
+        }
+
+        int defaultDecoderCount = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, 4);
+        int decoderCount = std::clamp(
+                GetProperty(videoJob.job_properties, "PARALLEL_DECODER_COUNT", defaultDecoderCount),
+                1, static_cast<int>(chunks_.size()));
+
+        // Frames are read in order, so a decoder that fills its queue only waits until the
+        // consumer reaches its chunk. Buffering whole chunks would keep
+        // decoderCount * PARALLEL_CHUNK_SIZE decoded frames in memory.
+        int queueCapacity = std::max(1, GetProperty(videoJob.job_properties, "FRAME_QUEUE_CAPACITY", 4));
+
+        // Open all of the videos before starting any threads so that there are no threads to
+        // clean up if opening a video fails.
+        std::vector<MPFVideoCapture> videoCaptures;
+        videoCaptures.reserve(decoderCount);
+        videoCaptures.push_back(std::move(firstDecoder));
+        for (int i = 1; i < decoderCount; i++) {
+            videoCaptures.emplace_back(videoJob, enableFrameTransformers, enableFrameFiltering);
+        }
+
+        decoders_.reserve(decoderCount);
+        try {
+            for (int decoderIdx = 0; decoderIdx < decoderCount; decoderIdx++) {
+                std::vector<std::pair<int, int>> decoderChunks;
+                for (size_t chunkIdx = decoderIdx; chunkIdx < chunks_.size(); chunkIdx += decoderCount) {
+                    decoderChunks.push_back(chunks_[chunkIdx]);
+                }
+
+                auto queue = std::make_unique<FrameQueue>(queueCapacity);
+                auto &queueRef = *queue;
+                decoders_.push_back({ std::move(queue), {} });
+                decoders_.back().doneDecodingFuture = std::async(
+                        std::launch::async, chunkDecoder, std::move(videoCaptures[decoderIdx]),
+                        std::move(decoderChunks), std::ref(queueRef));
+            }
+        }
+        catch (...) {
+            for (auto &decoder : decoders_) {
+                decoder.frameQueue->halt();
+            }
+            throw;
+        }
+    }
+
+
+    ParallelVideoCapture::~ParallelVideoCapture() {
+        for (auto &decoder : decoders_) {
+            decoder.frameQueue->halt();
+        }
+    }
+
+
+    std::vector<std::pair<int, int>> ParallelVideoCapture::CreateChunks(
+            const MPFVideoJob &videoJob, const FrameFilter &frameFilter, int chunkSize) {
+        int segmentFrameCount = frameFilter.GetSegmentFrameCount();
+        chunkSize = std::max(1, chunkSize);
+
+        std::vector<int> keyFrames;
+        if (segmentFrameCount > chunkSize) {
+            keyFrames = getKeyFrames(videoJob, frameFilter);
+        }
+
+        std::vector<std::pair<int, int>> chunks;
+        int chunkStart = 0;
+        while (chunkStart < segmentFrameCount) {
+            int nextChunkStart = chunkStart + chunkSize;
+            if (!keyFrames.empty() && nextChunkStart < segmentFrameCount) {
+                nextChunkStart = alignToKeyFrame(nextChunkStart, keyFrames, frameFilter);
+            }
+            nextChunkStart = std::min(nextChunkStart, segmentFrameCount);
+            chunks.emplace_back(chunkStart, nextChunkStart - 1);
+            chunkStart = nextChunkStart;
+        }
+        return chunks;
+    }
+
+
+    std::optional<MPFFrame> ParallelVideoCapture::Read() {
+        if (currentChunk_ >= chunks_.size()) {
+            return std::nullopt;
+        }
+
+        auto &decoder = decoders_[currentChunk_ % decoders_.size()];
+        std::optional<MPFFrame> frame;
+        try {
+            frame = decoder.frameQueue->pop();
+        }
+        catch (const QueueHaltedException&) {
+        }
+
+        if (!frame) {
+            // The decoder was not able to read all of its frames, so it is not possible to
+            // continue in order.
+            currentChunk_ = chunks_.size();
+            // If the decoder ended with an exception it will be re-thrown here.
+            decoder.doneDecodingFuture.get();
+            return std::nullopt;
+        }
+
+        framePosition_ = frame->index + 1;
+        if (frame->index >= chunks_[currentChunk_].second) {
+            currentChunk_++;
+        }
+        return frame;
+    }
+
+
+    int ParallelVideoCapture::GetCurrentFramePosition() const {
+        return framePosition_;
+    }
+
+    void ParallelVideoCapture::ReverseTransform(MPFVideoTrack &videoTrack) const {
+        reverseTransformer_(videoTrack);
+    }
+
+    int ParallelVideoCapture::ReverseTransform(MPFImageLocation &imageLocation, int segmentFrameIndex) const {
+        return reverseTransformer_(imageLocation, segmentFrameIndex);
+    }
+
+    ReverseTransformer ParallelVideoCapture::GetReverseTransformer() const {
+        return reverseTransformer_;
+    }
+
+    int ParallelVideoCapture::GetFrameCount() const {
+        return frameCount_;
+    }
+
+    double ParallelVideoCapture::GetFrameRate() const {
+        return frameRate_;
+    }
+
+    cv::Size ParallelVideoCapture::GetFrameSize() const {
+        return frameSize_;
+    }
+
+    cv::Size ParallelVideoCapture::GetOriginalFrameSize() const {
+        return originalFrameSize_;
+    }
+
+    const std::vector<std::pair<int, int>>& ParallelVideoCapture::GetChunks() const {
+        return chunks_;
+    }
+}
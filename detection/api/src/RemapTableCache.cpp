@@ -0,0 +1,138 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "RemapTableCache.h"
+
+#include <opencv2/imgproc.hpp>
+
+
+namespace MPF { namespace COMPONENT {
+
+    std::size_t RemapTableCache::Tables::GetByteCount() const {
+        return map1.total() * map1.elemSize() + map2.total() * map2.elemSize();
+    }
+
+
+    RemapTableCache::RemapTableCache(std::size_t maxBytes)
+        : maxBytes_(maxBytes)
+    {
+    }
+
+
+    RemapTableCache& RemapTableCache::GetInstance() {
+        // Intentionally leaked so that transformers used during static destruction can still
+        // look up their tables.
+        static auto *instance = new RemapTableCache;
+        return *instance;
+    }
+
+
+    std::shared_ptr<const RemapTableCache::Tables> RemapTableCache::Get(
+            const cv::Size &outputSize, const cv::Matx23d &reverseTransformationMatrix) {
+        const auto &m = reverseTransformationMatrix;
+        Key key { static_cast<double>(outputSize.width), static_cast<double>(outputSize.height),
+                  m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2) };
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto iter = entries_.find(key);
+            if (iter != entries_.end()) {
+                stats_.hitCount++;
+                lruKeys_.splice(lruKeys_.begin(), lruKeys_, iter->second.lruPosition);
+                return iter->second.tables;
+            }
+        }
+
+        // Build the tables without holding the lock so that other transformations are not blocked.
+        // If two threads miss on the same key at the same time, the first one to finish is cached.
+        auto tables = CreateTables(outputSize, reverseTransformationMatrix);
+        std::size_t newBytes = tables->GetByteCount();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.missCount++;
+        auto iter = entries_.find(key);
+        if (iter != entries_.end()) {
+            return iter->second.tables;
+        }
+        if (newBytes > maxBytes_) {
+            // Too big to cache, but the caller can still use it.
+            return tables;
+        }
+        EvictUntilFits(newBytes);
+        lruKeys_.push_front(key);
+        entries_.emplace(key, Entry{ tables, lruKeys_.begin() });
+        stats_.entryCount++;
+        stats_.bytes += newBytes;
+        return tables;
+    }
+
+
+    void RemapTableCache::EvictUntilFits(std::size_t newBytes) {
+        while (!lruKeys_.empty() && stats_.bytes + newBytes > maxBytes_) {
+            auto iter = entries_.find(lruKeys_.back());
+            stats_.bytes -= iter->second.tables->GetByteCount();
+            stats_.entryCount--;
+            stats_.evictionCount++;
+            entries_.erase(iter);
+            lruKeys_.pop_back();
+        }
+    }
+
+
+    std::shared_ptr<const RemapTableCache::Tables> RemapTableCache::CreateTables(
+            const cv::Size &outputSize, const cv::Matx23d &reverseTransformationMatrix) {
+        const auto &m = reverseTransformationMatrix;
+        cv::Mat_<float> mapX(outputSize);
+        cv::Mat_<float> mapY(outputSize);
+        for (int y = 0; y < outputSize.height; y++) {
+            auto *mapXRow = mapX[y];
+            auto *mapYRow = mapY[y];
+            for (int x = 0; x < outputSize.width; x++) {
+                mapXRow[x] = static_cast<float>(m(0, 0) * x + m(0, 1) * y + m(0, 2));
+                mapYRow[x] = static_cast<float>(m(1, 0) * x + m(1, 1) * y + m(1, 2));
+            }
+        }
+
+        auto tables = std::make_shared<Tables>();
+        // Converting to fixed-point lets cv::remap use its integer lookup tables.
+        cv::convertMaps(mapX, mapY, tables->map1, tables->map2, CV_16SC2);
+        return tables;
+    }
+
+
+    RemapTableCache::Stats RemapTableCache::GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+
+    void RemapTableCache::Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        lruKeys_.clear();
+        stats_.entryCount = 0;
+        stats_.bytes = 0;
+    }
+}}
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "SeekCostModel.h"
+
+#include <cstddef>
+#include <unordered_map>
+
+
+namespace MPF { namespace COMPONENT {
+
+    namespace {
+        // Enough for the videos that the segment jobs running in one process are likely to share.
+        constexpr std::size_t MAX_MODELS = 64;
+    }
+
+
+    std::shared_ptr<SeekCostModel> SeekCostModel::GetForVideo(const std::string &videoPath) {
+        // Intentionally leaked so that captures destroyed during static destruction can still
+        // use their models.
+        static auto *modelsMutex = new std::mutex;
+        static auto *models = new std::unordered_map<std::string, std::shared_ptr<SeekCostModel>>;
+
+        std::lock_guard<std::mutex> lock(*modelsMutex);
+        auto iter = models->find(videoPath);
+        if (iter != models->end()) {
+            return iter->second;
+        }
+        if (models->size() >= MAX_MODELS) {
+            models->erase(models->begin());
+        }
+        auto model = std::make_shared<SeekCostModel>();
+        models->emplace(videoPath, model);
+        return model;
+    }
+
+
+    bool SeekCostModel::ShouldGrab(int frameCount) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (grabMillisPerFrame_ < 0 || setPositionMillis_ < 0) {
+            return frameCount <= DEFAULT_MAX_GRAB_FRAMES;
+        }
+        return frameCount * grabMillisPerFrame_ <= setPositionMillis_;
+    }
+
+
+    void SeekCostModel::AddGrabSample(int frameCount, double milliseconds) {
+        if (frameCount < 1) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        AddSample(grabMillisPerFrame_, milliseconds / frameCount);
+    }
+
+
+    void SeekCostModel::AddSetPositionSample(double milliseconds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        AddSample(setPositionMillis_, milliseconds);
+    }
+
+
+    double SeekCostModel::GetGrabMillisPerFrame() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return grabMillisPerFrame_;
+    }
+
+
+    double SeekCostModel::GetSetPositionMillis() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return setPositionMillis_;
+    }
+
+
+    void SeekCostModel::AddSample(double &average, double sample) {
+        if (average < 0) {
+            average = sample;
+        }
+        else {
+            average += NEW_SAMPLE_WEIGHT * (sample - average);
+        }
+    }
+}}
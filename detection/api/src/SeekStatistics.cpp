@@ -0,0 +1,167 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "SeekStatistics.h"
+
+#include <cstdio>
+#include <sstream>
+#include <utility>
+
+
+namespace MPF { namespace COMPONENT {
+
+    namespace {
+        void WriteJsonString(std::ostream &out, const std::string &str) {
+            out << '"';
+            for (char c : str) {
+                switch (c) {
+                    case '"':
+                        out << "\\\"";
+                        break;
+                    case '\\':
+                        out << "\\\\";
+                        break;
+                    case '\n':
+                        out << "\\n";
+                        break;
+                    case '\r':
+                        out << "\\r";
+                        break;
+                    case '\t':
+                        out << "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            char escaped[7];
+                            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                            out << escaped;
+                        }
+                        else {
+                            out << c;
+                        }
+                }
+            }
+            out << '"';
+        }
+    }
+
+
+    SeekStatistics::SeekStatistics(std::string videoPath)
+            : videoPath_(std::move(videoPath)) {
+    }
+
+
+    void SeekStatistics::AddSeek(Seek seek) {
+        StrategyTotals &strategyTotals = totals_[seek.strategy];
+        strategyTotals.seekCount++;
+        if (seek.resultFrame != seek.requestedFrame) {
+            strategyTotals.failedSeekCount++;
+        }
+        strategyTotals.framesDecoded += seek.framesDecoded;
+        strategyTotals.wallTimeMillis += seek.wallTimeMillis;
+
+        if (seeks_.size() < MAX_RECORDED_SEEKS) {
+            seeks_.push_back(std::move(seek));
+        }
+    }
+
+
+    void SeekStatistics::AddFallback(Fallback fallback) {
+        fallbacks_.push_back(std::move(fallback));
+    }
+
+
+    const std::string& SeekStatistics::GetVideoPath() const {
+        return videoPath_;
+    }
+
+    const std::vector<SeekStatistics::Seek>& SeekStatistics::GetSeeks() const {
+        return seeks_;
+    }
+
+    const std::vector<SeekStatistics::Fallback>& SeekStatistics::GetFallbacks() const {
+        return fallbacks_;
+    }
+
+    const std::map<std::string, SeekStatistics::StrategyTotals>& SeekStatistics::GetTotals() const {
+        return totals_;
+    }
+
+
+    std::string SeekStatistics::ToJson() const {
+        std::ostringstream out;
+        out << "{\"videoPath\":";
+        WriteJsonString(out, videoPath_);
+
+        out << ",\"totals\":{";
+        bool first = true;
+        for (const auto &[strategy, strategyTotals] : totals_) {
+            if (!first) {
+                out << ',';
+            }
+            first = false;
+            WriteJsonString(out, strategy);
+            out << ":{\"seekCount\":" << strategyTotals.seekCount
+                << ",\"failedSeekCount\":" << strategyTotals.failedSeekCount
+                << ",\"framesDecoded\":" << strategyTotals.framesDecoded
+                << ",\"wallTimeMillis\":" << strategyTotals.wallTimeMillis << '}';
+        }
+
+        out << "},\"fallbacks\":[";
+        for (std::size_t i = 0; i < fallbacks_.size(); i++) {
+            if (i > 0) {
+                out << ',';
+            }
+            out << "{\"fromStrategy\":";
+            WriteJsonString(out, fallbacks_[i].fromStrategy);
+            out << ",\"toStrategy\":";
+            if (fallbacks_[i].toStrategy.empty()) {
+                out << "null";
+            }
+            else {
+                WriteJsonString(out, fallbacks_[i].toStrategy);
+            }
+            out << '}';
+        }
+
+        out << "],\"seeks\":[";
+        for (std::size_t i = 0; i < seeks_.size(); i++) {
+            const Seek &seek = seeks_[i];
+            if (i > 0) {
+                out << ',';
+            }
+            out << "{\"strategy\":";
+            WriteJsonString(out, seek.strategy);
+            out << ",\"startFrame\":" << seek.startFrame
+                << ",\"requestedFrame\":" << seek.requestedFrame
+                << ",\"resultFrame\":" << seek.resultFrame
+                << ",\"framesDecoded\":" << seek.framesDecoded
+                << ",\"wallTimeMillis\":" << seek.wallTimeMillis << '}';
+        }
+        out << "]}";
+        return out.str();
+    }
+}}
@@ -25,17 +25,89 @@
  ******************************************************************************/
 
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
 #include <iostream>
+#include <iterator>
+#include <utility>
+
 #include "SeekStrategy.h"
 
 namespace MPF { namespace COMPONENT {
 
+    namespace {
+        double MillisSince(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+
+    int SeekStrategy::GetFramesDecodedByLastSeek() const {
+        return framesDecoded_;
+    }
+
+
+
+    LazyKeyFrameIndex::LazyKeyFrameIndex(std::string videoPath, bool useDiskCache)
+            : videoPath_(std::move(videoPath))
+            , useDiskCache_(useDiskCache) {
+    }
+
+
+    const KeyFrameIndex::KeyFrames* LazyKeyFrameIndex::Get() const {
+        if (!loaded_) {
+            loaded_ = true;
+            try {
+                keyFrames_ = KeyFrameIndex::GetWithTimes(videoPath_, useDiskCache_);
+            }
+            catch (const std::exception &e) {
+                std::cerr << "Could not load the key frame index, so seeks will grab every frame "
+                          << "instead: " << e.what() << std::endl;
+            }
+        }
+        return keyFrames_.get();
+    }
+
+
+    int LazyKeyFrameIndex::GetKeyFrameAtOrBefore(int frame) const {
+        const KeyFrameIndex::KeyFrames *keyFrames = Get();
+        if (keyFrames == nullptr) {
+            return 0;
+        }
+        const auto &frameNumbers = keyFrames->frameNumbers;
+        auto iter = std::upper_bound(frameNumbers.begin(), frameNumbers.end(), frame);
+        return iter == frameNumbers.begin() ? 0 : *std::prev(iter);
+    }
+
+
+
+    SetFramePositionSeek::SetFramePositionSeek(std::shared_ptr<SeekCostModel> costModel,
+                                               std::shared_ptr<const LazyKeyFrameIndex> keyFrameIndex,
+                                               bool planWithKeyFrames)
+            : costModel_(std::move(costModel))
+            , keyFrameIndex_(std::move(keyFrameIndex))
+            , planWithKeyFrames_(planWithKeyFrames && keyFrameIndex_ != nullptr) {
+    }
+
+
     int SetFramePositionSeek::ChangePosition(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const {
+        framesDecoded_ = 0;
         int frameDiff = requestedPosition - currentPosition;
-        if (frameDiff > 0 && frameDiff <= SET_POS_MIN_FRAMES) {
-            return grabSeek_.ChangePosition(cap, currentPosition, requestedPosition);
+        auto start = std::chrono::steady_clock::now();
+        if (ShouldGrab(currentPosition, requestedPosition)) {
+            int newPosition = grabSeek_.ChangePosition(cap, currentPosition, requestedPosition);
+            framesDecoded_ = grabSeek_.GetFramesDecodedByLastSeek();
+            if (costModel_ && newPosition == requestedPosition) {
+                costModel_->AddGrabSample(frameDiff, MillisSince(start));
+            }
+            return newPosition;
         }
         else if (cap.set(cv::VideoCaptureProperties::CAP_PROP_POS_FRAMES, requestedPosition)) {
+            if (costModel_) {
+                costModel_->AddSetPositionSample(MillisSince(start));
+            }
             return requestedPosition;
         }
         else {
@@ -43,15 +115,172 @@ namespace MPF { namespace COMPONENT {
         }
     }
 
+
+    bool SetFramePositionSeek::ShouldGrab(int currentPosition, int requestedPosition) const {
+        int frameDiff = requestedPosition - currentPosition;
+        if (frameDiff <= 0) {
+            return false;
+        }
+
+        if (planWithKeyFrames_) {
+            // OpenCV never decodes fewer than DEFAULT_MAX_GRAB_FRAMES frames when setting the
+            // frame position, so the index is not needed for short jumps.
+            if (frameDiff <= SeekCostModel::DEFAULT_MAX_GRAB_FRAMES) {
+                return true;
+            }
+            if (keyFrameIndex_->Get() != nullptr) {
+                // OpenCV starts decoding from the key frame before requestedPosition - 16, so
+                // setting the frame position only helps when that key frame is after the current
+                // position.
+                int firstDecodedFrame = keyFrameIndex_->GetKeyFrameAtOrBefore(
+                        requestedPosition - SeekCostModel::DEFAULT_MAX_GRAB_FRAMES);
+                return firstDecodedFrame <= currentPosition;
+            }
+        }
+
+        return costModel_
+               ? costModel_->ShouldGrab(frameDiff)
+               : frameDiff <= SeekCostModel::DEFAULT_MAX_GRAB_FRAMES;
+    }
+
+
     SeekStrategy::CPtr SetFramePositionSeek::fallback() const {
+        if (keyFrameIndex_) {
+            std::cerr << "SetFramePositionSeek failed: falling back to IndexedSeek" << std::endl;
+            return SeekStrategy::CPtr(new IndexedSeek(keyFrameIndex_));
+        }
         std::cerr << "SetFramePositionSeek failed: falling back to GrabSeek" << std::endl;
         return SeekStrategy::CPtr(new GrabSeek);
     }
 
+    const char* SetFramePositionSeek::GetName() const {
+        return "SetFramePositionSeek";
+    }
+
+
+
+
+    IndexedSeek::IndexedSeek(std::string videoPath, bool useDiskCache)
+            : IndexedSeek(std::make_shared<LazyKeyFrameIndex>(std::move(videoPath), useDiskCache)) {
+    }
+
+
+    IndexedSeek::IndexedSeek(std::shared_ptr<const LazyKeyFrameIndex> keyFrameIndex)
+            : keyFrameIndex_(std::move(keyFrameIndex)) {
+    }
+
+
+    int IndexedSeek::ChangePosition(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const {
+        framesDecoded_ = 0;
+        const KeyFrameIndex::KeyFrames *keyFrames = keyFrameIndex_->Get();
+        if (keyFrames == nullptr) {
+            return GrabForward(cap, currentPosition, requestedPosition);
+        }
+
+        // SeekToKeyFrame leaves the capture just after the key frame, so only the key frames
+        // before the requested frame can be used.
+        const auto &frameNumbers = keyFrames->frameNumbers;
+        auto keyFrameIter = std::lower_bound(frameNumbers.begin(), frameNumbers.end(), requestedPosition);
+
+        bool newPositionInFuture = requestedPosition > currentPosition;
+        if (newPositionInFuture && !SeekingIsFaster(frameNumbers, currentPosition, requestedPosition)) {
+            return GrabForward(cap, currentPosition, requestedPosition);
+        }
+
+        // When the seek to the closest key frame can not be verified, the one before it is tried.
+        for (int attempt = 0; attempt < 2 && keyFrameIter != frameNumbers.begin(); attempt++) {
+            --keyFrameIter;
+            auto keyFrameIdx = keyFrameIter - frameNumbers.begin();
+            int position = SeekToKeyFrame(cap, *keyFrameIter, keyFrames->timesInMillis.at(keyFrameIdx));
+            if (position >= 0) {
+                return GrabForward(cap, position, requestedPosition);
+            }
+        }
+
+        if (!cap.set(cv::VideoCaptureProperties::CAP_PROP_POS_FRAMES, 0)) {
+            return currentPosition;
+        }
+        return GrabForward(cap, 0, requestedPosition);
+    }
+
+
+    bool IndexedSeek::SeekingIsFaster(const std::vector<int> &keyFrames, int currentPosition,
+                                      int requestedPosition) const {
+        auto keyFrameIter = std::lower_bound(keyFrames.begin(), keyFrames.end(), requestedPosition);
+        if (keyFrameIter == keyFrames.begin()) {
+            return false;
+        }
+        int keyFrame = *std::prev(keyFrameIter);
+        if (currentPosition >= keyFrame) {
+            // There are no key frames between the current position and the requested position,
+            // so seeking would decode at least as many frames as grabbing.
+            return false;
+        }
+        if (keyFrame == 0) {
+            return true;
+        }
+        // OpenCV decodes from the key frame before the point it seeks to, which is 16 frames
+        // before the time SeekToKeyFrame passes to it. Seeking only decodes fewer frames than
+        // grabbing when that key frame is after the current position.
+        int firstDecodedFrame = keyFrameIndex_->GetKeyFrameAtOrBefore(
+                keyFrame - SEEK_MARGIN_FRAMES - SeekCostModel::DEFAULT_MAX_GRAB_FRAMES);
+        return firstDecodedFrame > currentPosition;
+    }
+
+
+    int IndexedSeek::GrabForward(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const {
+        int newPosition = grabSeek_.ChangePosition(cap, currentPosition, requestedPosition);
+        framesDecoded_ += grabSeek_.GetFramesDecodedByLastSeek();
+        return newPosition;
+    }
+
+
+    int IndexedSeek::SeekToKeyFrame(cv::VideoCapture &cap, int keyFrame, double keyFrameTime) const {
+        if (keyFrame == 0) {
+            return cap.set(cv::VideoCaptureProperties::CAP_PROP_POS_FRAMES, 0) ? 0 : -1;
+        }
+
+        // OpenCV converts the time to a frame number using the average frame rate, so on a
+        // variable frame rate video it may stop a few frames before or after the key frame.
+        // Aiming a few frames early makes it much less likely to pass the key frame.
+        double fps = cap.get(cv::VideoCaptureProperties::CAP_PROP_FPS);
+        double seekTime = fps > 0
+                ? std::max(0.0, keyFrameTime - SEEK_MARGIN_FRAMES * 1000 / fps)
+                : keyFrameTime;
+        if (!cap.set(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC, seekTime)) {
+            return -1;
+        }
+        for (int i = 0; i < MAX_KEY_FRAME_SEARCH_FRAMES; i++) {
+            if (!cap.grab()) {
+                return -1;
+            }
+            framesDecoded_++;
+            double frameTime = cap.get(cv::VideoCaptureProperties::CAP_PROP_POS_MSEC);
+            if (std::abs(frameTime - keyFrameTime) <= TIME_TOLERANCE_MS) {
+                return keyFrame + 1;
+            }
+            if (frameTime > keyFrameTime) {
+                return -1;
+            }
+        }
+        return -1;
+    }
+
+
+    SeekStrategy::CPtr IndexedSeek::fallback() const {
+        std::cerr << "IndexedSeek failed: falling back to GrabSeek" << std::endl;
+        return SeekStrategy::CPtr(new GrabSeek);
+    }
+
+    const char* IndexedSeek::GetName() const {
+        return "IndexedSeek";
+    }
+
 
 
 
     int SequentialSeek::ChangePosition(cv::VideoCapture &cap, int currentPosition, int requestedPosition) const {
+        framesDecoded_ = 0;
         bool newPositionInFuture = requestedPosition > currentPosition;
 
         int start;
@@ -80,6 +309,7 @@ namespace MPF { namespace COMPONENT {
             }
         }
 
+        framesDecoded_ = numSuccess;
         return start + numSuccess;
     }
 
@@ -94,6 +324,10 @@ namespace MPF { namespace COMPONENT {
         return SeekStrategy::CPtr(new ReadSeek);
     }
 
+    const char* GrabSeek::GetName() const {
+        return "GrabSeek";
+    }
+
 
 
     bool ReadSeek::Advance(cv::VideoCapture &cap) const {
@@ -105,4 +339,8 @@ namespace MPF { namespace COMPONENT {
         std::cerr << "ReadSeek failed: No more fallbacks" << std::endl;
         return SeekStrategy::CPtr(nullptr);
     }
+
+    const char* ReadSeek::GetName() const {
+        return "ReadSeek";
+    }
 }}
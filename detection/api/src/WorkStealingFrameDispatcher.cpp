@@ -0,0 +1,141 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "WorkStealingFrameDispatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace MPF::COMPONENT {
+
+    WorkStealingFrameDispatcher::WorkStealingFrameDispatcher(MPFAsyncVideoCapture &videoCapture,
+                                                             int workerCount, int batchSize)
+            : videoCapture_(videoCapture)
+            , batchSize_(std::max(1, batchSize)) {
+        if (workerCount < 1) {
+            throw std::invalid_argument("WorkStealingFrameDispatcher requires at least one worker.");
+        }
+        for (int i = 0; i < workerCount; i++) {
+            workerDeques_.push_back(std::make_unique<WorkerDeque>());
+        }
+    }
+
+
+    std::optional<MPFFrame> WorkStealingFrameDispatcher::Read(int workerIndex) {
+        while (true) {
+            if (auto frame = PopLocal(workerIndex)) {
+                return frame;
+            }
+            if (auto frame = Steal(workerIndex)) {
+                return frame;
+            }
+            if (!Refill(workerIndex)) {
+                // No more frames will be added, but another worker may have received frames from
+                // the final refill after this worker checked the deques.
+                return Steal(workerIndex);
+            }
+        }
+    }
+
+
+    std::optional<MPFFrame> WorkStealingFrameDispatcher::PopLocal(int workerIndex) {
+        auto &workerDeque = *workerDeques_.at(workerIndex);
+        std::lock_guard<std::mutex> lock(workerDeque.mutex);
+        if (workerDeque.frames.empty()) {
+            return std::nullopt;
+        }
+        std::optional<MPFFrame> frame(std::move(workerDeque.frames.front()));
+        workerDeque.frames.pop_front();
+        return frame;
+    }
+
+
+    std::optional<MPFFrame> WorkStealingFrameDispatcher::Steal(int workerIndex) {
+        int workerCount = GetWorkerCount();
+        for (int offset = 1; offset <= workerCount; offset++) {
+            // When offset == workerCount, the worker's own deque is checked one final time.
+            auto &victim = *workerDeques_[(workerIndex + offset) % workerCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.frames.empty()) {
+                std::optional<MPFFrame> frame(std::move(victim.frames.back()));
+                victim.frames.pop_back();
+                if (offset != workerCount) {
+                    stealCount_++;
+                }
+                return frame;
+            }
+        }
+        return std::nullopt;
+    }
+
+
+    bool WorkStealingFrameDispatcher::Refill(int workerIndex) {
+        std::lock_guard<std::mutex> refillLock(refillMutex_);
+        if (sourceExhausted_) {
+            return false;
+        }
+        if (!AllDequesEmpty()) {
+            // Another worker refilled the deques while this worker was waiting for the lock.
+            return true;
+        }
+
+        int workerCount = GetWorkerCount();
+        auto frames = videoCapture_.ReadBatch(workerCount * batchSize_);
+        if (frames.empty()) {
+            sourceExhausted_ = true;
+            return false;
+        }
+
+        // The worker that performed the refill gets the earliest frames, and then each other
+        // worker gets the next batchSize_ frames.
+        for (size_t i = 0; i < frames.size(); i++) {
+            int targetWorker = (workerIndex + static_cast<int>(i) / batchSize_) % workerCount;
+            auto &workerDeque = *workerDeques_[targetWorker];
+            std::lock_guard<std::mutex> lock(workerDeque.mutex);
+            workerDeque.frames.push_back(std::move(frames[i]));
+        }
+        return true;
+    }
+
+
+    bool WorkStealingFrameDispatcher::AllDequesEmpty() {
+        return std::all_of(workerDeques_.begin(), workerDeques_.end(), [](auto &workerDeque) {
+            std::lock_guard<std::mutex> lock(workerDeque->mutex);
+            return workerDeque->frames.empty();
+        });
+    }
+
+
+    int WorkStealingFrameDispatcher::GetWorkerCount() const {
+        return static_cast<int>(workerDeques_.size());
+    }
+
+
+    long WorkStealingFrameDispatcher::GetStealCount() const {
+        return stealCount_;
+    }
+}
@@ -26,7 +26,9 @@
 
 #include "frame_transformers/AffineFrameTransformer.h"
 
+#include <algorithm>
 #include <cmath>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -41,34 +43,102 @@
 namespace MPF { namespace COMPONENT {
 
     namespace {
-        cv::Mat_<double> GetAllCorners(const std::vector<MPFRotatedRect> &regions) {
-            // Matrix containing each region's 4 corners. First row is x coordinate and second row is y coordinate.
-            cv::Mat_<double> corners(2, 4 * regions.size());
-            int cornerIdx = 0;
-            for (const auto& region : regions) {
-                for (const auto& corner : region.GetCorners()) {
-                    corners(0, cornerIdx) = corner.x;
-                    corners(1, cornerIdx) = corner.y;
-                    cornerIdx++;
+        bool IsInteger(double value) {
+            return std::abs(value - std::round(value)) < 1e-9;
+        }
+
+
+        // Returns the matrix rounded to integers when it maps each pixel to exactly one pixel.
+        // The linear part must only swap and/or negate the axes and the translation must be a
+        // whole number of pixels. Right angle rotation matrices are not exact because
+        // std::sin and std::cos are not exact, so the elements are allowed a small error.
+        std::optional<cv::Matx23i> GetWholePixelMapping(const cv::Matx23d &matrix) {
+            cv::Matx23i rounded;
+            for (int i = 0; i < 6; i++) {
+                if (!IsInteger(matrix.val[i])) {
+                    return {};
                 }
+                rounded.val[i] = cvRound(matrix.val[i]);
+            }
+            int a = rounded(0, 0);
+            int b = rounded(0, 1);
+            int c = rounded(1, 0);
+            int d = rounded(1, 1);
+            bool keepsAxes = std::abs(a) == 1 && std::abs(d) == 1 && b == 0 && c == 0;
+            bool swapsAxes = a == 0 && d == 0 && std::abs(b) == 1 && std::abs(c) == 1;
+            if (keepsAxes || swapsAxes) {
+                return rounded;
             }
-            return corners;
+            return {};
         }
 
+
         cv::Rect2d GetMappedBoundingRect(
                 const std::vector<MPFRotatedRect> &regions,
                 const cv::Matx33d &frameRotMat) {
 
             // Since we are working with 2d points and we aren't doing any translation here,
             // we can drop the last row and column to save some work.
-            cv::Mat_<double> simpleRotation = cv::Mat_<double>(frameRotMat, false)({0, 0, 2, 2});
-            cv::Mat_<double> mappedCorners = simpleRotation * GetAllCorners(regions);
+            cv::Matx22d simpleRotation = frameRotMat.get_minor<2, 2>(0, 0);
+            return MPFRotatedRectBatch(regions).GetMappedBoundingRect(simpleRotation);
+        }
 
-            double minX, maxX, minY, maxY;
-            cv::minMaxLoc(mappedCorners.row(0), &minX, &maxX);
-            cv::minMaxLoc(mappedCorners.row(1), &minY, &maxY);
 
-            return cv::Rect2d(cv::Point2d(minX, minY), cv::Point2d(maxX + 1, maxY + 1));
+        int GetInterpolationFlag(RotationInterpolation interpolation) {
+            switch (interpolation) {
+                case RotationInterpolation::NEAREST:
+                    return cv::INTER_NEAREST;
+                case RotationInterpolation::LINEAR:
+                case RotationInterpolation::FAST:
+                    return cv::INTER_LINEAR;
+                case RotationInterpolation::LANCZOS4:
+                    return cv::INTER_LANCZOS4;
+                case RotationInterpolation::CUBIC:
+                default:
+                    return cv::INTER_CUBIC;
+            }
+        }
+
+
+        // Detections in the same track usually have the same ROTATION property, so the most recent
+        // result is reused instead of parsing and formatting the property for every detection.
+        struct ReverseRotationMemo {
+            bool isSet = false;
+            std::string existingRotation;
+            std::string newRotation;
+        };
+
+
+        void ReverseRotationAndFlip(Properties &detectionProperties, double rotationDegrees,
+                                    bool flip, ReverseRotationMemo &memo) {
+            if (!DetectionComponentUtils::RotationAnglesEqual(rotationDegrees, 0)) {
+                auto rotationIter = detectionProperties.find("ROTATION");
+                // A missing ROTATION property and one that can not be parsed are both treated as 0.
+                std::string existingRotation = rotationIter == detectionProperties.end()
+                                               ? "" : rotationIter->second;
+                if (!memo.isSet || memo.existingRotation != existingRotation) {
+                    double existingRotationDegrees
+                            = DetectionComponentUtils::GetProperty(detectionProperties, "ROTATION", 0.0);
+                    double rotationAdjustAmount = flip ? 360 - rotationDegrees : rotationDegrees;
+                    double newRotation = DetectionComponentUtils::NormalizeAngle(
+                            existingRotationDegrees + rotationAdjustAmount);
+                    memo.existingRotation = std::move(existingRotation);
+                    memo.newRotation = std::to_string(newRotation);
+                    memo.isSet = true;
+                }
+                detectionProperties["ROTATION"] = memo.newRotation;
+            }
+
+            if (flip) {
+                bool existingFlip = DetectionComponentUtils::GetProperty(
+                        detectionProperties, "HORIZONTAL_FLIP", false);
+                if (existingFlip) {
+                    detectionProperties.erase("HORIZONTAL_FLIP");
+                }
+                else {
+                    detectionProperties.emplace("HORIZONTAL_FLIP", "true");
+                }
+            }
         }
 
 
@@ -124,10 +194,12 @@ namespace MPF { namespace COMPONENT {
                 double frameRotationDegrees,
                 bool flip,
                 const cv::Scalar &fillColor,
-                const SearchRegion &postTransformSearchRegion)
+                const SearchRegion &postTransformSearchRegion,
+                RotationInterpolation interpolation)
             : rotationDegrees_(frameRotationDegrees)
             , flip_(flip)
             , fillColor_(fillColor)
+            , interpolation_(interpolation)
     {
         if (preTransformRegions.empty()) {
             throw std::length_error(
@@ -173,26 +245,114 @@ namespace MPF { namespace COMPONENT {
         cv::Matx23d combined2dTransform = combinedTransform.get_minor<2, 3>(0, 0);
 
         cv::invertAffineTransform(combined2dTransform, reverseTransformationMatrix_);
+        wholePixelMapping_ = GetWholePixelMapping(reverseTransformationMatrix_);
+        if (interpolation_ == RotationInterpolation::FAST && !wholePixelMapping_) {
+            remapTables_ = std::make_shared<RemapTablesHandle>();
+        }
     }
 
 
     void AffineTransformation::Apply(cv::Mat &frame) const {
+        if (wholePixelMapping_) {
+            ApplyWholePixelMapping(frame);
+            return;
+        }
+        if (remapTables_) {
+            const RemapTableCache::Tables &tables = GetRemapTables();
+            cv::Mat output;
+            output.allocator = frame.allocator;
+            cv::remap(frame, output, tables.map1, tables.map2, cv::INTER_LINEAR,
+                      cv::BORDER_CONSTANT, fillColor_);
+            frame = output;
+            return;
+        }
+
         // From cv::warpAffine docs:
         // The function warpAffine transforms the source image using the specified matrix when the flag
         // WARP_INVERSE_MAP is set. Otherwise, the transformation is first inverted with cv::invertAffineTransform.
         // From OpenCV's Geometric Image Transformations module documentation:
         // To avoid sampling artifacts, the mapping is done in the reverse order, from destination to the source.
 
-        // Using INTER_CUBIC, because according to
+        // Defaults to INTER_CUBIC, because according to
         // https://en.wikipedia.org/wiki/Affine_transformation#Image_transformation
         // "This transform relocates pixels requiring intensity interpolation to approximate the value of moved pixels,
         // bicubic interpolation is the standard for image transformations in image processing applications."
         cv::warpAffine(frame, frame, reverseTransformationMatrix_, regionSize_,
-                       cv::InterpolationFlags::WARP_INVERSE_MAP | cv::InterpolationFlags::INTER_CUBIC,
+                       cv::InterpolationFlags::WARP_INVERSE_MAP | GetInterpolationFlag(interpolation_),
                        cv::BORDER_CONSTANT, fillColor_);
     }
 
 
+    const RemapTableCache::Tables& AffineTransformation::GetRemapTables() const {
+        std::call_once(remapTables_->initialized, [this] {
+            remapTables_->tables = RemapTableCache::GetInstance().Get(
+                    cv::Size(regionSize_), reverseTransformationMatrix_);
+        });
+        return *remapTables_->tables;
+    }
+
+
+
+    void AffineTransformation::ApplyWholePixelMapping(cv::Mat &frame) const {
+        // With WARP_INVERSE_MAP, output pixel (x, y) comes from input pixel mapping * (x, y, 1).
+        const cv::Matx23i &mapping = *wholePixelMapping_;
+        cv::Size outputSize(regionSize_);
+        cv::Vec2i firstCorner = mapping * cv::Vec3i(0, 0, 1);
+        cv::Vec2i lastCorner = mapping * cv::Vec3i(outputSize.width - 1, outputSize.height - 1, 1);
+        cv::Rect sourceRect(
+                cv::Point(std::min(firstCorner[0], lastCorner[0]), std::min(firstCorner[1], lastCorner[1])),
+                cv::Point(std::max(firstCorner[0], lastCorner[0]) + 1,
+                          std::max(firstCorner[1], lastCorner[1]) + 1));
+        cv::Rect inFrameSourceRect = sourceRect & cv::Rect(cv::Point(0, 0), frame.size());
+
+        cv::Mat source;
+        if (inFrameSourceRect == sourceRect) {
+            source = frame(sourceRect);
+        }
+        else {
+            // At whole pixel positions the INTER_CUBIC weights of the neighboring pixels are zero,
+            // so copying the pixels and filling the rest produces the same image as
+            // cv::warpAffine.
+            source.allocator = frame.allocator;
+            source.create(sourceRect.size(), frame.type());
+            source.setTo(fillColor_);
+            if (!inFrameSourceRect.empty()) {
+                frame(inFrameSourceRect).copyTo(source(inFrameSourceRect - sourceRect.tl()));
+            }
+        }
+
+        bool swapsAxes = mapping(0, 0) == 0;
+        // cv::flip codes: 0 reverses the rows, 1 reverses the columns, and -1 reverses both.
+        bool reverseRows;
+        bool reverseColumns;
+        if (swapsAxes) {
+            reverseRows = mapping(0, 1) == -1;
+            reverseColumns = mapping(1, 0) == -1;
+        }
+        else {
+            reverseRows = mapping(1, 1) == -1;
+            reverseColumns = mapping(0, 0) == -1;
+        }
+
+        if (!swapsAxes && !reverseRows && !reverseColumns) {
+            frame = source;
+            return;
+        }
+
+        cv::Mat output;
+        output.allocator = frame.allocator;
+        if (swapsAxes) {
+            cv::transpose(source, output);
+            source = output;
+        }
+        if (reverseRows || reverseColumns) {
+            int flipCode = reverseRows && reverseColumns ? -1 : (reverseRows ? 0 : 1);
+            cv::flip(source, output, flipCode);
+        }
+        frame = output;
+    }
+
+
 
     void AffineTransformation::ApplyReverse(MPFImageLocation &imageLocation) const {
         cv::Vec3d topLeft(imageLocation.x_left_upper, imageLocation.y_left_upper, 1);
@@ -201,25 +361,30 @@ namespace MPF { namespace COMPONENT {
         imageLocation.x_left_upper = cv::saturate_cast<int>(newTopLeft[0]);
         imageLocation.y_left_upper = cv::saturate_cast<int>(newTopLeft[1]);
 
-        if (!DetectionComponentUtils::RotationAnglesEqual(rotationDegrees_, 0)) {
-            double existingRotation
-                    = DetectionComponentUtils::GetProperty(imageLocation.detection_properties, "ROTATION", 0.0);
+        ReverseRotationMemo memo;
+        ReverseRotationAndFlip(imageLocation.detection_properties, rotationDegrees_, flip_, memo);
+    }
 
-            double rotationAdjustAmount = flip_ ? 360 - rotationDegrees_ : rotationDegrees_;
-            double newRotation = DetectionComponentUtils::NormalizeAngle(existingRotation + rotationAdjustAmount);
 
-            imageLocation.detection_properties["ROTATION"] = std::to_string(newRotation);
+    void AffineTransformation::ApplyReverse(const std::vector<MPFImageLocation*> &imageLocations) const {
+        if (imageLocations.empty()) {
+            return;
         }
 
-        if (flip_) {
-            bool existingFlip = DetectionComponentUtils::GetProperty(
-                    imageLocation.detection_properties, "HORIZONTAL_FLIP", false);
-            if (existingFlip) {
-                imageLocation.detection_properties.erase("HORIZONTAL_FLIP");
-            }
-            else {
-                imageLocation.detection_properties.emplace("HORIZONTAL_FLIP", "true");
-            }
+        std::vector<cv::Point2d> topLefts;
+        topLefts.reserve(imageLocations.size());
+        for (const MPFImageLocation *imageLocation : imageLocations) {
+            topLefts.emplace_back(imageLocation->x_left_upper, imageLocation->y_left_upper);
+        }
+        std::vector<cv::Point2d> newTopLefts;
+        cv::transform(topLefts, newTopLefts, reverseTransformationMatrix_);
+
+        ReverseRotationMemo memo;
+        for (size_t i = 0; i < imageLocations.size(); i++) {
+            MPFImageLocation &imageLocation = *imageLocations[i];
+            imageLocation.x_left_upper = cv::saturate_cast<int>(newTopLefts[i].x);
+            imageLocation.y_left_upper = cv::saturate_cast<int>(newTopLefts[i].y);
+            ReverseRotationAndFlip(imageLocation.detection_properties, rotationDegrees_, flip_, memo);
         }
     }
 
@@ -236,9 +401,11 @@ namespace MPF { namespace COMPONENT {
                                                    bool flip,
                                                    const cv::Scalar &fillColor,
                                                    const SearchRegion &searchRegion,
-                                                   IFrameTransformer::Ptr innerTransform)
+                                                   IFrameTransformer::Ptr innerTransform,
+                                                   RotationInterpolation interpolation)
             : BaseDecoratedTransformer(std::move(innerTransform))
-            , transform_(fullFrame(GetInnerFrameSize(0)), rotation, flip, fillColor, searchRegion)
+            , transform_(fullFrame(GetInnerFrameSize(0)), rotation, flip, fillColor, searchRegion,
+                         interpolation)
     {
     }
 
@@ -247,9 +414,11 @@ namespace MPF { namespace COMPONENT {
     AffineFrameTransformer::AffineFrameTransformer(double rotation,
                                                    bool flip,
                                                    const cv::Scalar &fillColor,
-                                                   IFrameTransformer::Ptr innerTransform)
+                                                   IFrameTransformer::Ptr innerTransform,
+                                                   RotationInterpolation interpolation)
             : BaseDecoratedTransformer(std::move(innerTransform))
-            , transform_(fullFrame(GetInnerFrameSize(0)), rotation, flip, fillColor)
+            , transform_(fullFrame(GetInnerFrameSize(0)), rotation, flip, fillColor, {},
+                         interpolation)
     {
     }
 
@@ -258,9 +427,10 @@ namespace MPF { namespace COMPONENT {
     AffineFrameTransformer::AffineFrameTransformer(const std::vector<MPFRotatedRect> &regions,
                                                    double frameRotation, bool frameFlip,
                                                    const cv::Scalar &fillColor,
-                                                   IFrameTransformer::Ptr innerTransform)
+                                                   IFrameTransformer::Ptr innerTransform,
+                                                   RotationInterpolation interpolation)
             : BaseDecoratedTransformer(std::move(innerTransform))
-            , transform_(regions, frameRotation, frameFlip, fillColor)
+            , transform_(regions, frameRotation, frameFlip, fillColor, {}, interpolation)
     {
     }
 
@@ -281,57 +451,82 @@ namespace MPF { namespace COMPONENT {
     }
 
 
+    void AffineFrameTransformer::DoReverseTransformAll(
+            const std::vector<MPFImageLocation*> &imageLocations,
+            const std::vector<int> &frameIndices) const {
+        transform_.ApplyReverse(imageLocations);
+    }
+
+
 
 
     FeedForwardExactRegionAffineTransformer::FeedForwardExactRegionAffineTransformer(
-                const std::vector<MPFRotatedRect> &regions,
+                std::vector<MPFRotatedRect> regions,
                 const cv::Scalar &fillColor,
-                IFrameTransformer::Ptr innerTransform)
+                IFrameTransformer::Ptr innerTransform,
+                RotationInterpolation interpolation)
             : BaseDecoratedTransformer(std::move(innerTransform))
-            , frameTransforms_(CreateTransformations(regions, fillColor))
+            , regions_(std::move(regions))
+            , fillColor_(fillColor)
+            // Each frame has its own matrix, so a remap table would only be used once. Building it
+            // is slower than cv::warpAffine and would push reusable tables out of
+            // RemapTableCache.
+            , interpolation_(interpolation == RotationInterpolation::FAST
+                             ? RotationInterpolation::LINEAR : interpolation)
     {
     }
 
 
     cv::Size FeedForwardExactRegionAffineTransformer::GetFrameSize(int frameIndex) const {
-        return GetTransform(frameIndex).GetRegionSize();
+        return GetTransform(frameIndex)->GetRegionSize();
     }
 
 
-    std::vector<AffineTransformation> FeedForwardExactRegionAffineTransformer::CreateTransformations(
-            const std::vector<MPFRotatedRect> &regions, const cv::Scalar &fillColor) {
+    std::shared_ptr<const AffineTransformation> FeedForwardExactRegionAffineTransformer::GetTransform(
+            int frameIndex) const {
+        {
+            std::lock_guard<std::mutex> lock(transformsMutex_);
+            auto iter = cachedTransforms_.find(frameIndex);
+            if (iter != cachedTransforms_.end()) {
+                return iter->second;
+            }
+        }
 
-        std::vector<AffineTransformation> transforms;
-        transforms.reserve(regions.size());
+        // Built without holding the lock so that other frames can be transformed in parallel.
+        auto transform = CreateTransformation(frameIndex);
 
-        for (const auto& region : regions) {
-            double frameRotation = region.flip ? 360 - region.rotation : region.rotation;
-            transforms.emplace_back(std::vector<MPFRotatedRect>{ region }, frameRotation,
-                                    region.flip, fillColor);
+        std::lock_guard<std::mutex> lock(transformsMutex_);
+        cachedTransforms_.emplace(frameIndex, transform);
+        if (cachedTransforms_.size() > MAX_CACHED_TRANSFORMS) {
+            cachedTransforms_.erase(cachedTransforms_.begin());
         }
-        return transforms;
+        return transform;
     }
 
 
-    const AffineTransformation &FeedForwardExactRegionAffineTransformer::GetTransform(int frameIndex) const {
-        try {
-            return frameTransforms_.at(frameIndex);
-        }
-        catch (const std::out_of_range &error) {
+    std::shared_ptr<const AffineTransformation> FeedForwardExactRegionAffineTransformer::CreateTransformation(
+            int frameIndex) const {
+        if (frameIndex < 0 || frameIndex >= static_cast<int>(regions_.size())) {
             std::stringstream ss;
             ss << "Attempted to get transformation for frame: " << frameIndex
-               << ", but there are only " << frameTransforms_.size() << " entries in the feed forward track.";
+               << ", but there are only " << regions_.size() << " entries in the feed forward track.";
             throw std::out_of_range(ss.str());
         }
+
+        const MPFRotatedRect &region = regions_[frameIndex];
+        double frameRotation = region.flip ? 360 - region.rotation : region.rotation;
+        return std::make_shared<const AffineTransformation>(
+                std::vector<MPFRotatedRect>{ region }, frameRotation, region.flip, fillColor_,
+                SearchRegion(), interpolation_);
     }
 
     void FeedForwardExactRegionAffineTransformer::DoFrameTransform(cv::Mat &frame,
                                                                    int frameIndex) const {
-        GetTransform(frameIndex).Apply(frame);
+        GetTransform(frameIndex)->Apply(frame);
     }
 
     void FeedForwardExactRegionAffineTransformer::DoReverseTransform(
             MPFImageLocation &imageLocation, int frameIndex) const {
-        GetTransform(frameIndex).ApplyReverse(imageLocation);
+        GetTransform(frameIndex)->ApplyReverse(imageLocation);
     }
 }}
@@ -41,6 +41,15 @@ namespace MPF { namespace COMPONENT {
     }
 
 
+    void BaseDecoratedTransformer::TransformFrames(std::vector<cv::Mat> &frames,
+                                                   int firstFrameIndex) const {
+        innerTransform_->TransformFrames(frames, firstFrameIndex);
+        for (size_t i = 0; i < frames.size(); i++) {
+            DoFrameTransform(frames[i], firstFrameIndex + static_cast<int>(i));
+        }
+    }
+
+
     void BaseDecoratedTransformer::ReverseTransform(MPFImageLocation &imageLocation,
                                                     int frameIndex) const {
         DoReverseTransform(imageLocation, frameIndex);
@@ -48,6 +57,23 @@ namespace MPF { namespace COMPONENT {
     }
 
 
+    void BaseDecoratedTransformer::ReverseTransformAll(
+            const std::vector<MPFImageLocation*> &imageLocations,
+            const std::vector<int> &frameIndices) const {
+        DoReverseTransformAll(imageLocations, frameIndices);
+        innerTransform_->ReverseTransformAll(imageLocations, frameIndices);
+    }
+
+
+    void BaseDecoratedTransformer::DoReverseTransformAll(
+            const std::vector<MPFImageLocation*> &imageLocations,
+            const std::vector<int> &frameIndices) const {
+        for (size_t i = 0; i < imageLocations.size(); i++) {
+            DoReverseTransform(*imageLocations[i], frameIndices[i]);
+        }
+    }
+
+
     cv::Size BaseDecoratedTransformer::GetInnerFrameSize(int frameIndex) const {
         return innerTransform_->GetFrameSize(frameIndex);
     }
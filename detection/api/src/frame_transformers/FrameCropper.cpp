@@ -29,16 +29,27 @@
 
 #include "frame_transformers/FrameCropper.h"
 
+#include "FramePool.h"
+
 
 namespace MPF { namespace COMPONENT {
 
-    FrameCropper::FrameCropper(IFrameTransformer::Ptr innerTransform)
-            : BaseDecoratedTransformer(std::move(innerTransform)) {
+    FrameCropper::FrameCropper(IFrameTransformer::Ptr innerTransform, CropPolicy cropPolicy)
+            : BaseDecoratedTransformer(std::move(innerTransform))
+            , cropPolicy_(cropPolicy) {
     }
 
 
     void FrameCropper::DoFrameTransform(cv::Mat &frame, int frameIndex) const {
-        frame = frame(GetRegionOfInterest(frameIndex));
+        const cv::Rect roi = GetRegionOfInterest(frameIndex);
+        if (cropPolicy_ == CropPolicy::KEEP_VIEW || roi.size() == frame.size()) {
+            frame = frame(roi);
+            return;
+        }
+        cv::Mat compactFrame;
+        FramePool::GetInstance().Use(compactFrame);
+        frame(roi).copyTo(compactFrame);
+        frame = std::move(compactFrame);
     }
 
 
@@ -61,8 +72,9 @@ namespace MPF { namespace COMPONENT {
 
 
     SearchRegionFrameCropper::SearchRegionFrameCropper(const cv::Rect &regionOfInterest,
-                                                       IFrameTransformer::Ptr innerTransform)
-        : FrameCropper(std::move(innerTransform))
+                                                       IFrameTransformer::Ptr innerTransform,
+                                                       CropPolicy cropPolicy)
+        : FrameCropper(std::move(innerTransform), cropPolicy)
         , searchRegion_(GetIntersectingRegion(regionOfInterest, 0)) {
     }
 
@@ -75,8 +87,9 @@ namespace MPF { namespace COMPONENT {
 
 
     FeedForwardFrameCropper::FeedForwardFrameCropper(const std::map<int, MPFImageLocation> &track,
-                                                     IFrameTransformer::Ptr innerTransform)
-        : FrameCropper(std::move(innerTransform)) {
+                                                     IFrameTransformer::Ptr innerTransform,
+                                                     CropPolicy cropPolicy)
+        : FrameCropper(std::move(innerTransform), cropPolicy) {
 
         fedForwardDetections_.reserve(track.size());
 
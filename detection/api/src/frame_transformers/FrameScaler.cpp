@@ -0,0 +1,91 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <opencv2/imgproc.hpp>
+
+#include "frame_transformers/FrameScaler.h"
+
+
+namespace MPF { namespace COMPONENT {
+
+    FrameScaler::FrameScaler(const cv::Size &scaledSize, IFrameTransformer::Ptr innerTransform)
+            : BaseDecoratedTransformer(std::move(innerTransform))
+            , scaledSize_(scaledSize)
+            , reverseScaleX_(static_cast<double>(GetInnerFrameSize(0).width) / scaledSize.width)
+            , reverseScaleY_(static_cast<double>(GetInnerFrameSize(0).height) / scaledSize.height) {
+    }
+
+
+    cv::Size FrameScaler::GetFrameSize(int frameIndex) const {
+        return scaledSize_;
+    }
+
+
+    cv::Size FrameScaler::GetScaledSize(const cv::Size &frameSize, int maxDimension) {
+        int largestDimension = std::max(frameSize.width, frameSize.height);
+        if (maxDimension <= 0 || largestDimension <= maxDimension) {
+            return frameSize;
+        }
+        double scale = static_cast<double>(maxDimension) / largestDimension;
+        return {
+            std::max(1, static_cast<int>(std::lround(frameSize.width * scale))),
+            std::max(1, static_cast<int>(std::lround(frameSize.height * scale)))
+        };
+    }
+
+
+    void FrameScaler::DoFrameTransform(cv::Mat &frame, int frameIndex) const {
+        if (frame.size() == scaledSize_) {
+            return;
+        }
+        cv::Mat scaledFrame;
+        // Only uses FramePool when the capture was configured to use it.
+        scaledFrame.allocator = frame.allocator;
+        // INTER_AREA averages all of the source pixels that map to each output pixel, so it does
+        // not alias when shrinking.
+        cv::resize(frame, scaledFrame, scaledSize_, 0, 0, cv::INTER_AREA);
+        frame = std::move(scaledFrame);
+    }
+
+
+    void FrameScaler::DoReverseTransform(MPFImageLocation &imageLocation, int frameIndex) const {
+        // Scale the corners rather than the size, so that adjacent detections stay adjacent.
+        int left = static_cast<int>(std::lround(imageLocation.x_left_upper * reverseScaleX_));
+        int top = static_cast<int>(std::lround(imageLocation.y_left_upper * reverseScaleY_));
+        int right = static_cast<int>(std::lround(
+                (imageLocation.x_left_upper + imageLocation.width) * reverseScaleX_));
+        int bottom = static_cast<int>(std::lround(
+                (imageLocation.y_left_upper + imageLocation.height) * reverseScaleY_));
+        imageLocation.x_left_upper = left;
+        imageLocation.y_left_upper = top;
+        imageLocation.width = right - left;
+        imageLocation.height = bottom - top;
+    }
+}}
@@ -26,6 +26,7 @@
 
 #include "frame_transformers/FrameTransformerFactory.h"
 
+#include <cmath>
 #include <iostream>
 #include <map>
 #include <optional>
@@ -41,6 +42,7 @@
 #include "detectionComponentUtils.h"
 #include "frame_transformers/AffineFrameTransformer.h"
 #include "frame_transformers/FrameCropper.h"
+#include "frame_transformers/FrameScaler.h"
 #include "frame_transformers/NoOpFrameTransformer.h"
 #include "frame_transformers/IFrameTransformer.h"
 #include "frame_transformers/SearchRegion.h"
@@ -62,13 +64,18 @@ namespace {
     }
 
 
-    RegionEdge::resolve_region_edge_t GetRegionEdge(const Properties &props, const std::string& property) {
+    // The scale converts absolute values from original frame coordinates to the coordinates
+    // of a frame shrunk by FrameScaler.
+    RegionEdge::resolve_region_edge_t GetRegionEdge(const Properties &props, const std::string& property,
+                                                    double scale) {
         try {
             std::string propVal = GetProperty(props, property, "-1");
             if (propVal.find('%') != std::string::npos) {
                 return RegionEdge::Percentage(std::stod(propVal));
             }
-            return RegionEdge::Absolute(std::stoi(propVal));
+            // Rounding down keeps negative values negative, so RegionEdge::Absolute still treats
+            // them as unset.
+            return RegionEdge::Absolute(static_cast<int>(std::floor(std::stoi(propVal) * scale)));
         }
         catch (const std::invalid_argument&) {
             // Failed to convert property to number
@@ -77,20 +84,58 @@ namespace {
     }
 
 
-    SearchRegion GetSearchRegion(const Properties &props) {
+    SearchRegion GetSearchRegion(const Properties &props, const cv::Vec2d &scale) {
         if (!SearchRegionCroppingIsEnabled(props)) {
             return { };
         }
         return {
-                GetRegionEdge(props, "SEARCH_REGION_TOP_LEFT_X_DETECTION"),
-                GetRegionEdge(props, "SEARCH_REGION_TOP_LEFT_Y_DETECTION"),
-                GetRegionEdge(props, "SEARCH_REGION_BOTTOM_RIGHT_X_DETECTION"),
-                GetRegionEdge(props, "SEARCH_REGION_BOTTOM_RIGHT_Y_DETECTION"),
+                GetRegionEdge(props, "SEARCH_REGION_TOP_LEFT_X_DETECTION", scale[0]),
+                GetRegionEdge(props, "SEARCH_REGION_TOP_LEFT_Y_DETECTION", scale[1]),
+                GetRegionEdge(props, "SEARCH_REGION_BOTTOM_RIGHT_X_DETECTION", scale[0]),
+                GetRegionEdge(props, "SEARCH_REGION_BOTTOM_RIGHT_Y_DETECTION", scale[1]),
         };
 
     }
 
 
+    /**
+     * Adds a FrameScaler when DECODE_MAX_DIMENSION is smaller than the frame. It must be added
+     * before any other transformer, so that the others only process the smaller frames.
+     * @return Multiply by this to convert original frame coordinates to scaled frame coordinates
+     */
+    cv::Vec2d AddScalerIfNeeded(const Properties &jobProperties, const cv::Size &inputVideoSize,
+                                IFrameTransformer::Ptr &currentTransformer) {
+        int maxDimension = GetProperty(jobProperties, "DECODE_MAX_DIMENSION", -1);
+        cv::Size scaledSize = FrameScaler::GetScaledSize(inputVideoSize, maxDimension);
+        if (scaledSize == inputVideoSize) {
+            return {1, 1};
+        }
+        currentTransformer = IFrameTransformer::Ptr(
+                new FrameScaler(scaledSize, std::move(currentTransformer)));
+        return {
+            static_cast<double>(scaledSize.width) / inputVideoSize.width,
+            static_cast<double>(scaledSize.height) / inputVideoSize.height
+        };
+    }
+
+
+    std::map<int, MPFImageLocation> ScaleDetections(const std::map<int, MPFImageLocation> &detections,
+                                                    const cv::Vec2d &scale) {
+        std::map<int, MPFImageLocation> scaledDetections(detections);
+        for (auto &[frameIndex, detection] : scaledDetections) {
+            int left = static_cast<int>(std::lround(detection.x_left_upper * scale[0]));
+            int top = static_cast<int>(std::lround(detection.y_left_upper * scale[1]));
+            int right = static_cast<int>(std::lround((detection.x_left_upper + detection.width) * scale[0]));
+            int bottom = static_cast<int>(std::lround((detection.y_left_upper + detection.height) * scale[1]));
+            detection.x_left_upper = left;
+            detection.y_left_upper = top;
+            detection.width = right - left;
+            detection.height = bottom - top;
+        }
+        return scaledDetections;
+    }
+
+
     cv::Rect ToRect(const MPFImageLocation &imageLocation) {
         return {imageLocation.x_left_upper, imageLocation.y_left_upper, imageLocation.width, imageLocation.height};
     }
@@ -130,6 +175,50 @@ namespace {
     }
 
 
+    RotationInterpolation GetRotationInterpolation(const Properties &props) {
+        auto interpolationName = GetProperty(props, "ROTATION_INTERPOLATION", "CUBIC");
+        std::string nameWithoutPrefix = interpolationName;
+        if (boost::istarts_with(nameWithoutPrefix, "INTER_")) {
+            nameWithoutPrefix = nameWithoutPrefix.substr(6);
+        }
+
+        static const std::pair<const char*, RotationInterpolation> interpolations[] {
+                { "NEAREST", RotationInterpolation::NEAREST },
+                { "LINEAR", RotationInterpolation::LINEAR },
+                { "CUBIC", RotationInterpolation::CUBIC },
+                { "LANCZOS4", RotationInterpolation::LANCZOS4 },
+                { "FAST", RotationInterpolation::FAST }
+        };
+        for (const auto &[name, interpolation] : interpolations) {
+            if (boost::iequals(name, nameWithoutPrefix)) {
+                return interpolation;
+            }
+        }
+        throw MPFDetectionException(
+                MPFDetectionError::MPF_INVALID_PROPERTY,
+                "Expected the \"ROTATION_INTERPOLATION\" property to be one of \"NEAREST\","
+                " \"LINEAR\", \"CUBIC\", \"LANCZOS4\", or \"FAST\", but it was set to \""
+                + interpolationName + "\".");
+    }
+
+
+    CropPolicy GetCropPolicy(const Properties &props) {
+        auto cropPolicyName = GetProperty(props, "CROP_POLICY", "KEEP_VIEW");
+        if (boost::iequals("KEEP_VIEW", cropPolicyName)) {
+            return CropPolicy::KEEP_VIEW;
+        }
+        else if (boost::iequals("COMPACT_COPY", cropPolicyName)) {
+            return CropPolicy::COMPACT_COPY;
+        }
+        else {
+            throw MPFDetectionException(
+                    MPFDetectionError::MPF_INVALID_PROPERTY,
+                    "Expected the \"CROP_POLICY\" property to be either \"KEEP_VIEW\""
+                    " or \"COMPACT_COPY\", but it was set to \"" + cropPolicyName + "\".");
+        }
+    }
+
+
     std::optional<double> GetJobRotation(const Properties &jobProperties,
                                          const Properties &mediaProperties) {
         if (auto optJobRotation = GetProperty<double>(jobProperties, "ROTATION");
@@ -161,6 +250,8 @@ namespace {
 
     void AddTransformersIfNeeded(const Properties &jobProperties, const Properties &mediaProperties,
                                  const cv::Size &inputVideoSize, IFrameTransformer::Ptr &currentTransformer) {
+        cv::Vec2d scale = AddScalerIfNeeded(jobProperties, inputVideoSize, currentTransformer);
+        cv::Size frameSize = currentTransformer->GetFrameSize(0);
         double rotation = GetJobRotation(jobProperties, mediaProperties).value_or(0);
 
         double rotationThreshold = GetProperty(jobProperties, "ROTATION_THRESHOLD", 0.1);
@@ -172,19 +263,21 @@ namespace {
 
         bool flipRequired = GetJobFlip(jobProperties, mediaProperties).value_or(false);
 
-        SearchRegion searchRegion = GetSearchRegion(jobProperties);
+        SearchRegion searchRegion = GetSearchRegion(jobProperties, scale);
 
         if (rotationRequired || flipRequired) {
             currentTransformer = IFrameTransformer::Ptr(
                     new AffineFrameTransformer(rotation, flipRequired, GetFillColor(jobProperties),
-                                               searchRegion, std::move(currentTransformer)));
+                                               searchRegion, std::move(currentTransformer),
+                                               GetRotationInterpolation(jobProperties)));
         }
         else {
-            cv::Rect frameRect(cv::Point(0, 0), inputVideoSize);
-            cv::Rect searchRegionRect = searchRegion.GetRect(inputVideoSize);
+            cv::Rect frameRect(cv::Point(0, 0), frameSize);
+            cv::Rect searchRegionRect = searchRegion.GetRect(frameSize);
             if (frameRect != searchRegionRect) {
                 currentTransformer = IFrameTransformer::Ptr(
-                        new SearchRegionFrameCropper(searchRegionRect, std::move(currentTransformer)));
+                        new SearchRegionFrameCropper(searchRegionRect, std::move(currentTransformer),
+                                                     GetCropPolicy(jobProperties)));
             }
         }
     }
@@ -196,21 +289,24 @@ namespace {
                     "FEED_FORWARD_TYPE: SUPERSET_REGION is enabled, but feed forward track was empty.");
         }
 
-        auto it = regions.begin();
-        cv::Rect2d region = it->GetBoundingRect();
-        ++it;
-
-        for (; it != regions.end(); ++it) {
-            region |= it->GetBoundingRect();
-        }
-        return region;
+        return MPFRotatedRectBatch(regions).GetBoundingRect();
     }
 
 
     void AddFeedForwardRegionTransformersIfNeeded(const Properties &jobProperties, const Properties &mediaProperties,
                                                   const Properties &trackProperties,
-                                                  const std::map<int, MPFImageLocation> &detections,
+                                                  const std::map<int, MPFImageLocation> &originalDetections,
+                                                  const cv::Size &inputVideoSize,
                                                   IFrameTransformer::Ptr &currentTransformer) {
+        cv::Vec2d scale = AddScalerIfNeeded(jobProperties, inputVideoSize, currentTransformer);
+        // The feed forward detections are in original frame coordinates, so they need to be
+        // scaled to match frames shrunk by FrameScaler.
+        std::optional<std::map<int, MPFImageLocation>> scaledDetections;
+        if (scale != cv::Vec2d(1, 1)) {
+            scaledDetections = ScaleDetections(originalDetections, scale);
+        }
+        const auto &detections = scaledDetections ? *scaledDetections : originalDetections;
+
         if (SearchRegionCroppingIsEnabled(jobProperties)) {
             std::cerr << "Both feed forward cropping and search region cropping properties were provided. "
                       << "Only feed forward cropping will occur." << std::endl;
@@ -307,12 +403,14 @@ namespace {
             if (anyDetectionRequiresRotationOrFlip) {
                 currentTransformer = IFrameTransformer::Ptr(
                         new FeedForwardExactRegionAffineTransformer(
-                                regions, GetFillColor(jobProperties),
-                                std::move(currentTransformer)));
+                                std::move(regions), GetFillColor(jobProperties),
+                                std::move(currentTransformer),
+                                GetRotationInterpolation(jobProperties)));
             }
             else {
                 currentTransformer = IFrameTransformer::Ptr(
-                        new FeedForwardFrameCropper(detections, std::move(currentTransformer)));
+                        new FeedForwardFrameCropper(detections, std::move(currentTransformer),
+                                                    GetCropPolicy(jobProperties)));
             }
         }
         else {
@@ -320,12 +418,14 @@ namespace {
                 currentTransformer = IFrameTransformer::Ptr(
                         new AffineFrameTransformer(regions, jobLevelRotation, jobLevelFlip,
                                                    GetFillColor(jobProperties),
-                                                   std::move(currentTransformer)));
+                                                   std::move(currentTransformer),
+                                                   GetRotationInterpolation(jobProperties)));
             }
             else {
                 cv::Rect supersetRegion = GetSupersetRegionNoRotation(regions);
                 currentTransformer = IFrameTransformer::Ptr(
-                        new SearchRegionFrameCropper(supersetRegion, std::move(currentTransformer)));
+                        new SearchRegionFrameCropper(supersetRegion, std::move(currentTransformer),
+                                                     GetCropPolicy(jobProperties)));
             }
         }
     }
@@ -343,7 +443,8 @@ namespace {
                         "Feed forward is enabled, but feed forward track was empty.");
             }
             AddFeedForwardRegionTransformersIfNeeded(job.job_properties, job.media_properties,
-                                                     trackProperties, trackLocations, transformer);
+                                                     trackProperties, trackLocations, inputVideoSize,
+                                                     transformer);
         }
         else {
             AddTransformersIfNeeded(job.job_properties, job.media_properties, inputVideoSize, transformer);
@@ -41,10 +41,19 @@ namespace MPF { namespace COMPONENT {
 
     }
 
+    void NoOpFrameTransformer::TransformFrames(std::vector<cv::Mat> &frames, int firstFrameIndex) const {
+
+    }
+
     void NoOpFrameTransformer::ReverseTransform(MPFImageLocation &imageLocation,
                                                 int frameIndex) const {
 
     }
 
+    void NoOpFrameTransformer::ReverseTransformAll(const std::vector<MPFImageLocation*> &imageLocations,
+                                                   const std::vector<int> &frameIndices) const {
+
+    }
+
 
 }}
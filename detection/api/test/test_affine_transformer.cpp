@@ -25,6 +25,7 @@
  ******************************************************************************/
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <string>
 #include <vector>
@@ -35,13 +36,17 @@
 
 #include "detectionComponentUtils.h"
 #include "frame_transformers/AffineFrameTransformer.h"
+#include "frame_transformers/FrameScaler.h"
 #include "frame_transformers/FrameTransformerFactory.h"
 #include "frame_transformers/NoOpFrameTransformer.h"
 #include "MPFAsyncVideoCapture.h"
 #include "MPFDetectionComponent.h"
+#include "MPFDetectionException.h"
 #include "MPFDetectionObjects.h"
 #include "MPFImageReader.h"
+#include "MPFRotatedRect.h"
 #include "MPFVideoCapture.h"
+#include "RemapTableCache.h"
 
 
 using namespace MPF::COMPONENT;
@@ -142,6 +147,56 @@ void verifyCorrectlyRotated(const std::string &fileName,  const MPFImageLocation
 
 
 
+namespace {
+    cv::Mat transformFrame(const cv::Mat &frame, double rotation, bool flip) {
+        AffineFrameTransformer transformer(
+                rotation, flip, cv::Scalar(255, 255, 255),
+                IFrameTransformer::Ptr(new NoOpFrameTransformer(frame.size())));
+        cv::Mat result = frame.clone();
+        transformer.TransformFrame(result, 0);
+        return result;
+    }
+
+    // Transforms the frame with cv::warpAffine directly, so that the result never goes through
+    // AffineTransformation's whole pixel path.
+    cv::Mat warpAffineFrame(const cv::Mat &frame, double rotation, bool flip) {
+        AffineTransformation transformation(
+                { MPFRotatedRect(0, 0, frame.cols, frame.rows, 0, false) },
+                rotation, flip, cv::Scalar(255, 255, 255));
+        // Recover the transformation's reverse matrix from where it maps the origin and the unit
+        // vectors. For right angles the matrix elements are whole numbers, so ApplyReverse's
+        // rounding to int does not change them.
+        auto reverseMap = [&transformation](int x, int y) {
+            MPFImageLocation location(x, y, 1, 1);
+            transformation.ApplyReverse(location);
+            return cv::Vec2d(location.x_left_upper, location.y_left_upper);
+        };
+        cv::Vec2d origin = reverseMap(0, 0);
+        cv::Vec2d xAxis = reverseMap(1, 0) - origin;
+        cv::Vec2d yAxis = reverseMap(0, 1) - origin;
+        cv::Matx23d reverseMatrix(xAxis[0], yAxis[0], origin[0],
+                                  xAxis[1], yAxis[1], origin[1]);
+
+        cv::Mat result;
+        cv::warpAffine(frame, result, reverseMatrix, cv::Size(transformation.GetRegionSize()),
+                       cv::WARP_INVERSE_MAP | cv::INTER_CUBIC, cv::BORDER_CONSTANT,
+                       cv::Scalar(255, 255, 255));
+        return result;
+    }
+
+    cv::Mat createRandomFrame(const cv::Size &size) {
+        cv::Mat frame(size, CV_8UC3);
+        cv::randu(frame, 0, 256);
+        return frame;
+    }
+
+    // An angle this close to a right angle still goes through cv::warpAffine, but every
+    // output pixel maps to within a tiny fraction of an input pixel, so the result is the same as
+    // the lossless right angle path.
+    constexpr double NEAR_RIGHT_ANGLE_OFFSET = 1e-7;
+}
+
+
 TEST(AffineFrameTransformerTest, CanHandleRotatedDetectionNearMiddle) {
     verifyCorrectlyRotated("20deg-bounding-box.png",
                            MPFImageLocation(116, 218, 100, 40, -1, { { "ROTATION", "20" } }));
@@ -251,6 +306,66 @@ TEST(AffineFrameTransformerTest, TestFeedForwardExactRegion) {
 }
 
 
+TEST(AffineFrameTransformerTest, FeedForwardExactRegionBuildsTransformationsOnDemand) {
+    cv::Mat frame = createRandomFrame(cv::Size(64, 48));
+    std::vector<MPFRotatedRect> regions;
+    for (int i = 0; i < 100000; i++) {
+        regions.emplace_back(10 + i % 20, 10, 20, 10, i % 360, i % 2 == 1);
+    }
+
+    FeedForwardExactRegionAffineTransformer transformer(
+            regions, cv::Scalar(0, 0, 0),
+            IFrameTransformer::Ptr(new NoOpFrameTransformer(frame.size())));
+
+    for (int frameIndex : { 0, 12345, 99999, 12345 }) {
+        const MPFRotatedRect &region = regions.at(frameIndex);
+        double frameRotation = region.flip ? 360 - region.rotation : region.rotation;
+        AffineTransformation expectedTransform({ region }, frameRotation, region.flip,
+                                               cv::Scalar(0, 0, 0));
+        cv::Mat expectedFrame = frame.clone();
+        expectedTransform.Apply(expectedFrame);
+
+        cv::Mat transformedFrame = frame.clone();
+        transformer.TransformFrame(transformedFrame, frameIndex);
+        ASSERT_EQ(expectedFrame.size(), transformer.GetFrameSize(frameIndex));
+        ASSERT_EQ(cv::norm(expectedFrame, transformedFrame, cv::NORM_INF), 0);
+    }
+
+    cv::Mat transformedFrame = frame.clone();
+    ASSERT_THROW(transformer.TransformFrame(transformedFrame, 100000), std::out_of_range);
+}
+
+
+TEST(AffineFrameTransformerTest, UnrotatedFeedForwardRegionSkipsWarp) {
+    MPFVideoTrack ffTrack(0, 1);
+    ffTrack.frame_locations.emplace(0, MPFImageLocation(60, 300, 100, 40, -1, { { "ROTATION", "260" } }));
+    // Extends past the top left corner of the frame.
+    ffTrack.frame_locations.emplace(1, MPFImageLocation(-10, -5, 130, 20, -1, { { "ROTATION", "0" } }));
+
+    MPFVideoJob job("Test", "test/test_imgs/rotation/feed-forward-rotation-test.png",
+                    ffTrack.start_frame, ffTrack.stop_frame, ffTrack,
+                    { {"FEED_FORWARD_TYPE", "REGION"} }, {});
+
+    const cv::Mat testImg = cv::imread(job.data_uri);
+    IFrameTransformer::Ptr transformer = FrameTransformerFactory::GetTransformer(job, testImg.size());
+
+    cv::Mat frame = testImg.clone();
+    transformer->TransformFrame(frame, 1);
+
+    cv::Matx23d translation(1, 0, -10,
+                            0, 1, -5);
+    cv::Mat expectedFrame;
+    cv::warpAffine(testImg, expectedFrame, translation, cv::Size(130, 20),
+                   cv::WARP_INVERSE_MAP | cv::INTER_CUBIC, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
+    ASSERT_EQ(frame.size(), expectedFrame.size());
+    ASSERT_EQ(cv::norm(frame, expectedFrame, cv::NORM_INF), 0);
+
+    MPFImageLocation detection(0, 0, frame.cols, frame.rows);
+    transformer->ReverseTransform(detection, 1);
+    assertDetectionsSameLocation(detection, ffTrack.frame_locations.at(1));
+}
+
+
 TEST(AffineFrameTransformerTest, TestFeedForwardSupersetRegion) {
     MPFVideoTrack ffTrack(0, 2);
     ffTrack.frame_locations.emplace(0, MPFImageLocation(60, 300, 100, 40, -1, { { "ROTATION", "260" } }));
@@ -359,6 +474,95 @@ TEST(AffineFrameTransformerTest, ReverseTransformWithFlip) {
 }
 
 
+TEST(AffineFrameTransformerTest, ReverseTransformAllMatchesReverseTransform) {
+    Properties jobProps {
+            {"ROTATION", "30"},
+            {"HORIZONTAL_FLIP", "true"},
+            {"SEARCH_REGION_ENABLE_DETECTION", "true"},
+            {"SEARCH_REGION_TOP_LEFT_X_DETECTION", "10"},
+            {"SEARCH_REGION_TOP_LEFT_Y_DETECTION", "20"}
+    };
+    MPFVideoJob job("Test", "test/test_imgs/rotation/feed-forward-rotation-test.png", 0, 1000,
+                    jobProps, {});
+    IFrameTransformer::Ptr transformer = FrameTransformerFactory::GetTransformer(
+            job, cv::Size(640, 480));
+
+    std::vector<MPFImageLocation> expected;
+    for (int i = 0; i < 100; i++) {
+        Properties detectionProps;
+        if (i % 3 == 1) {
+            detectionProps.emplace("ROTATION", "45");
+        }
+        if (i % 4 == 1) {
+            detectionProps.emplace("HORIZONTAL_FLIP", "true");
+        }
+        expected.emplace_back(i, 2 * i, 10, 20, -1, detectionProps);
+    }
+
+    std::vector<MPFImageLocation> batch = expected;
+    std::vector<MPFImageLocation*> batchPtrs;
+    std::vector<int> frameIndices;
+    for (size_t i = 0; i < batch.size(); i++) {
+        transformer->ReverseTransform(expected[i], static_cast<int>(i));
+        batchPtrs.push_back(&batch[i]);
+        frameIndices.push_back(static_cast<int>(i));
+    }
+    transformer->ReverseTransformAll(batchPtrs, frameIndices);
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        ASSERT_EQ(expected[i].x_left_upper, batch[i].x_left_upper);
+        ASSERT_EQ(expected[i].y_left_upper, batch[i].y_left_upper);
+        ASSERT_EQ(expected[i].detection_properties, batch[i].detection_properties);
+    }
+}
+
+
+TEST(AffineFrameTransformerTest, RightAngleRotationsMatchWarpAffine) {
+    cv::Mat frame = createRandomFrame(cv::Size(37, 23));
+    for (double rotation : { 0, 90, 180, 270 }) {
+        for (bool flip : { false, true }) {
+            if (rotation == 0 && !flip) {
+                continue;
+            }
+            cv::Mat fastResult = transformFrame(frame, rotation, flip);
+            cv::Mat warpResult = warpAffineFrame(frame, rotation, flip);
+            ASSERT_EQ(fastResult.size(), warpResult.size()) << "rotation: " << rotation << " flip: " << flip;
+            ASSERT_EQ(cv::norm(fastResult, warpResult, cv::NORM_INF), 0)
+                    << "rotation: " << rotation << " flip: " << flip;
+        }
+    }
+}
+
+
+// Benchmark: records how much faster the right angle path is than cv::warpAffine at common
+// resolutions.
+TEST(AffineFrameTransformerTest, RightAngleRotationSpeedup) {
+    using Clock = std::chrono::steady_clock;
+    for (const cv::Size &size : { cv::Size(640, 480), cv::Size(1920, 1080), cv::Size(3840, 2160) }) {
+        cv::Mat frame = createRandomFrame(size);
+        constexpr int iterations = 3;
+
+        auto fastStart = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            transformFrame(frame, 90, false);
+        }
+        auto fastTime = Clock::now() - fastStart;
+
+        auto warpStart = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            transformFrame(frame, 90 + NEAR_RIGHT_ANGLE_OFFSET, false);
+        }
+        auto warpTime = Clock::now() - warpStart;
+
+        double speedup = std::chrono::duration<double>(warpTime).count()
+                         / std::max(1e-9, std::chrono::duration<double>(fastTime).count());
+        ::testing::Test::RecordProperty(
+                "Speedup" + std::to_string(size.width) + "x" + std::to_string(size.height),
+                std::to_string(speedup));
+    }
+}
+
+
 TEST(AffineFrameTransformerTest, FlipRotateFullFrame) {
     double frameRotation = 345;
     MPFImageJob job("test", "test/test_imgs/rotation/hello-world-flip.png", {
@@ -467,6 +671,188 @@ TEST(AffineFrameTransformerTest, TestRotationFillColor) {
 }
 
 
+TEST(AffineFrameTransformerTest, TestRotationInterpolation) {
+    const auto *test_img_path = "test/test_imgs/rotation/hello-world.png";
+    auto getRotatedImage = [&](const std::string &interpolation) {
+        MPFImageJob job("test", test_img_path,
+                        { {"ROTATION", "30"}, {"ROTATION_INTERPOLATION", interpolation} }, {});
+        return MPFImageReader(job).GetImage();
+    };
+
+    cv::Mat cubicImg = getRotatedImage("CUBIC");
+    ASSERT_EQ(cv::norm(cubicImg, getRotatedImage("INTER_CUBIC"), cv::NORM_INF), 0);
+
+    cv::Mat linearImg = getRotatedImage("LINEAR");
+    for (const auto &interpolation : { "NEAREST", "LINEAR", "LANCZOS4", "FAST" }) {
+        cv::Mat img = getRotatedImage(interpolation);
+        ASSERT_EQ(img.size(), cubicImg.size()) << interpolation;
+        // Only the edges of the text should be different.
+        ASSERT_LT(cv::norm(img, cubicImg, cv::NORM_L1) / img.total(), 5) << interpolation;
+    }
+    // FAST uses bilinear interpolation, so the only differences are from the fixed-point maps.
+    ASSERT_LE(cv::norm(getRotatedImage("FAST"), linearImg, cv::NORM_INF), 2);
+
+    MPFImageJob invalidJob("test", test_img_path,
+                           { {"ROTATION", "30"}, {"ROTATION_INTERPOLATION", "BAD"} }, {});
+    ASSERT_THROW(FrameTransformerFactory::GetTransformer(invalidJob, cubicImg.size()),
+                 MPFDetectionException);
+}
+
+
+TEST(AffineFrameTransformerTest, FastInterpolationReusesRemapTables) {
+    cv::Mat frame = createRandomFrame(cv::Size(64, 48));
+    AffineFrameTransformer transformer(
+            30, false, cv::Scalar(0, 0, 0),
+            IFrameTransformer::Ptr(new NoOpFrameTransformer(frame.size())),
+            RotationInterpolation::FAST);
+
+    cv::Mat firstResult = frame.clone();
+    transformer.TransformFrame(firstResult, 0);
+    cv::Mat secondResult = frame.clone();
+    transformer.TransformFrame(secondResult, 1);
+    ASSERT_EQ(cv::norm(firstResult, secondResult, cv::NORM_INF), 0);
+}
+
+
+TEST(AffineFrameTransformerTest, FastInterpolationSharesRemapTablesAcrossTransformers) {
+    RemapTableCache &cache = RemapTableCache::GetInstance();
+    cache.Clear();
+    RemapTableCache::Stats initialStats = cache.GetStats();
+
+    cv::Mat frame = createRandomFrame(cv::Size(64, 48));
+    cv::Mat results[2];
+    for (cv::Mat &result : results) {
+        AffineFrameTransformer transformer(
+                30, false, cv::Scalar(0, 0, 0),
+                IFrameTransformer::Ptr(new NoOpFrameTransformer(frame.size())),
+                RotationInterpolation::FAST);
+        result = frame.clone();
+        transformer.TransformFrame(result, 0);
+    }
+    ASSERT_EQ(cv::norm(results[0], results[1], cv::NORM_INF), 0);
+
+    RemapTableCache::Stats stats = cache.GetStats();
+    ASSERT_EQ(1, stats.entryCount);
+    ASSERT_EQ(initialStats.missCount + 1, stats.missCount);
+    ASSERT_EQ(initialStats.hitCount + 1, stats.hitCount);
+    // CV_16SC2 map1 plus CV_16UC1 map2.
+    ASSERT_EQ(results[0].total() * 6, stats.bytes);
+
+    cache.Clear();
+    ASSERT_EQ(0, cache.GetStats().entryCount);
+    ASSERT_EQ(0, cache.GetStats().bytes);
+}
+
+
+TEST(AffineFrameTransformerTest, FastInterpolationDoesNotCacheFeedForwardExactRegionTables) {
+    RemapTableCache &cache = RemapTableCache::GetInstance();
+    cache.Clear();
+    RemapTableCache::Stats initialStats = cache.GetStats();
+
+    cv::Mat frame = createRandomFrame(cv::Size(64, 48));
+    std::vector<MPFRotatedRect> regions {
+            MPFRotatedRect(10, 20, 30, 15, 30, false),
+            MPFRotatedRect(12, 21, 30, 15, 31, false)
+    };
+    FeedForwardExactRegionAffineTransformer fastTransformer(
+            regions, cv::Scalar(0, 0, 0),
+            IFrameTransformer::Ptr(new NoOpFrameTransformer(frame.size())),
+            RotationInterpolation::FAST);
+    FeedForwardExactRegionAffineTransformer linearTransformer(
+            regions, cv::Scalar(0, 0, 0),
+            IFrameTransformer::Ptr(new NoOpFrameTransformer(frame.size())),
+            RotationInterpolation::LINEAR);
+
+    for (int frameIndex = 0; frameIndex < static_cast<int>(regions.size()); frameIndex++) {
+        cv::Mat fastResult = frame.clone();
+        fastTransformer.TransformFrame(fastResult, frameIndex);
+        cv::Mat linearResult = frame.clone();
+        linearTransformer.TransformFrame(linearResult, frameIndex);
+        ASSERT_EQ(cv::norm(fastResult, linearResult, cv::NORM_INF), 0);
+    }
+
+    RemapTableCache::Stats stats = cache.GetStats();
+    ASSERT_EQ(0, stats.entryCount);
+    ASSERT_EQ(initialStats.missCount, stats.missCount);
+}
+
+
+TEST(RemapTableCacheTest, EvictsLeastRecentlyUsedTables) {
+    cv::Size size(100, 10);
+    std::size_t tableBytes = size.area() * 6;
+    RemapTableCache cache(tableBytes * 2);
+
+    cv::Matx23d first(1, 0, 0.5, 0, 1, 0);
+    cv::Matx23d second(1, 0, 1.5, 0, 1, 0);
+    cv::Matx23d third(1, 0, 2.5, 0, 1, 0);
+
+    auto firstTables = cache.Get(size, first);
+    cache.Get(size, second);
+    // Makes second the least recently used.
+    ASSERT_EQ(firstTables, cache.Get(size, first));
+    cache.Get(size, third);
+
+    RemapTableCache::Stats stats = cache.GetStats();
+    ASSERT_EQ(2, stats.entryCount);
+    ASSERT_EQ(tableBytes * 2, stats.bytes);
+    ASSERT_EQ(1, stats.evictionCount);
+    ASSERT_EQ(1, stats.hitCount);
+    ASSERT_EQ(3, stats.missCount);
+
+    ASSERT_EQ(firstTables, cache.Get(size, first));
+    cache.Get(size, second);
+    ASSERT_EQ(4, cache.GetStats().missCount);
+}
+
+
+TEST(MPFRotatedRectBatchTest, MatchesIndividualRects) {
+    cv::RNG rng(1234);
+    std::vector<MPFRotatedRect> rects;
+    for (int i = 0; i < 1000; i++) {
+        // Include some angles that are close enough to 0 to be treated as unrotated.
+        double rotation = i % 10 == 0 ? 0.05 : rng.uniform(0.0, 360.0);
+        rects.emplace_back(rng.uniform(-100.0, 500.0), rng.uniform(-100.0, 500.0),
+                           rng.uniform(1.0, 200.0), rng.uniform(1.0, 200.0),
+                           rotation, i % 3 == 0);
+    }
+    MPFRotatedRectBatch batch(rects);
+    ASSERT_EQ(rects.size(), batch.Size());
+
+    std::vector<cv::Point2d> batchCorners = batch.GetCorners();
+    std::vector<cv::Rect2d> batchBoundingRects = batch.GetBoundingRects();
+    cv::Rect2d expectedSuperset = rects.front().GetBoundingRect();
+    for (size_t i = 0; i < rects.size(); i++) {
+        std::array<cv::Point2d, 4> corners = rects[i].GetCorners();
+        for (size_t j = 0; j < corners.size(); j++) {
+            ASSERT_NEAR(corners[j].x, batchCorners[4 * i + j].x, 1e-9);
+            ASSERT_NEAR(corners[j].y, batchCorners[4 * i + j].y, 1e-9);
+        }
+        cv::Rect2d boundingRect = rects[i].GetBoundingRect();
+        ASSERT_NEAR(boundingRect.x, batchBoundingRects[i].x, 1e-9);
+        ASSERT_NEAR(boundingRect.y, batchBoundingRects[i].y, 1e-9);
+        ASSERT_NEAR(boundingRect.width, batchBoundingRects[i].width, 1e-9);
+        ASSERT_NEAR(boundingRect.height, batchBoundingRects[i].height, 1e-9);
+        expectedSuperset |= boundingRect;
+    }
+
+    cv::Rect2d superset = batch.GetBoundingRect();
+    ASSERT_NEAR(expectedSuperset.x, superset.x, 1e-9);
+    ASSERT_NEAR(expectedSuperset.y, superset.y, 1e-9);
+    ASSERT_NEAR(expectedSuperset.width, superset.width, 1e-9);
+    ASSERT_NEAR(expectedSuperset.height, superset.height, 1e-9);
+
+    // A 90 degree rotation around the origin maps (x, y) to (y, -x).
+    cv::Matx22d rotation(0, 1,
+                         -1, 0);
+    cv::Rect2d mapped = batch.GetMappedBoundingRect(rotation);
+    double maxX = expectedSuperset.x + expectedSuperset.width - 1;
+    ASSERT_NEAR(expectedSuperset.y, mapped.x, 1e-9);
+    ASSERT_NEAR(-maxX, mapped.y, 1e-9);
+    ASSERT_NEAR(expectedSuperset.height, mapped.width, 1e-9);
+    ASSERT_NEAR(expectedSuperset.width, mapped.height, 1e-9);
+}
+
+
 TEST(AffineFrameTransformerTest, SearchRegionWithOrthogonalRotation) {
 
     Properties absoluteProps {
@@ -619,3 +1005,67 @@ TEST(AffineFrameTransformerTest, MediaPropsIgnoredWithoutAutoOrientation) {
     auto black_corner = img(cv::Rect(cv::Point(300, 170), cv::Point(img.cols, img.rows)));
     assertImageColor(black_corner, { 0, 0, 0 });
 }
+
+
+TEST(FrameScalerTest, ComputesScaledSize) {
+    ASSERT_EQ(cv::Size(640, 360), FrameScaler::GetScaledSize(cv::Size(1920, 1080), 640));
+    ASSERT_EQ(cv::Size(360, 640), FrameScaler::GetScaledSize(cv::Size(1080, 1920), 640));
+    ASSERT_EQ(cv::Size(320, 200), FrameScaler::GetScaledSize(cv::Size(320, 200), 640));
+    ASSERT_EQ(cv::Size(320, 200), FrameScaler::GetScaledSize(cv::Size(320, 200), -1));
+}
+
+
+TEST(FrameScalerTest, ScalesSearchRegionAndReverseTransform) {
+    MPFImageJob job("test", "test/test_imgs/test_img.png", {
+            {"DECODE_MAX_DIMENSION", "160"},
+            {"SEARCH_REGION_ENABLE_DETECTION", "true"},
+            {"SEARCH_REGION_TOP_LEFT_X_DETECTION", "100"},
+            {"SEARCH_REGION_TOP_LEFT_Y_DETECTION", "50"},
+            {"SEARCH_REGION_BOTTOM_RIGHT_X_DETECTION", "300"},
+            {"SEARCH_REGION_BOTTOM_RIGHT_Y_DETECTION", "150"}
+    }, {});
+    cv::Mat originalImg = cv::imread(job.data_uri);
+    ASSERT_EQ(cv::Size(320, 200), originalImg.size());
+
+    IFrameTransformer::Ptr transformer = FrameTransformerFactory::GetTransformer(job, originalImg.size());
+    ASSERT_EQ(cv::Size(100, 50), transformer->GetFrameSize(0));
+
+    cv::Mat img = MPFImageReader(job).GetImage();
+    ASSERT_EQ(cv::Size(100, 50), img.size());
+    cv::Mat expectedImg;
+    cv::resize(originalImg, expectedImg, cv::Size(160, 100), 0, 0, cv::INTER_AREA);
+    ASSERT_EQ(0, cv::norm(img, expectedImg(cv::Rect(50, 25, 100, 50)), cv::NORM_INF));
+
+    MPFImageLocation detection(10, 5, 20, 30);
+    transformer->ReverseTransform(detection, 0);
+    assertDetectionsSameLocation(MPFImageLocation(120, 60, 40, 60), detection);
+}
+
+
+TEST(FrameScalerTest, ScalesFeedForwardRegions) {
+    MPFVideoTrack ffTrack(0, 1);
+    ffTrack.frame_locations.emplace(0, MPFImageLocation(60, 300, 100, 40, -1, { { "ROTATION", "260" } }));
+    ffTrack.frame_locations.emplace(1, MPFImageLocation(20, 40, 130, 20, -1, { { "ROTATION", "0" } }));
+
+    MPFVideoJob job("Test", "test/test_imgs/rotation/feed-forward-rotation-test.png",
+                    ffTrack.start_frame, ffTrack.stop_frame, ffTrack,
+                    { {"FEED_FORWARD_TYPE", "REGION"} }, {});
+    const cv::Mat testImg = cv::imread(job.data_uri);
+    int maxDimension = std::max(testImg.cols, testImg.rows) / 2;
+    job.job_properties["DECODE_MAX_DIMENSION"] = std::to_string(maxDimension);
+
+    IFrameTransformer::Ptr transformer = FrameTransformerFactory::GetTransformer(job, testImg.size());
+    for (const auto &[frameIndex, ffDetection] : ffTrack.frame_locations) {
+        cv::Mat frame = testImg.clone();
+        transformer->TransformFrame(frame, frameIndex);
+        ASSERT_NEAR(ffDetection.width / 2.0, frame.cols, 1);
+        ASSERT_NEAR(ffDetection.height / 2.0, frame.rows, 1);
+
+        MPFImageLocation detection(0, 0, frame.cols, frame.rows);
+        transformer->ReverseTransform(detection, frameIndex);
+        ASSERT_NEAR(ffDetection.x_left_upper, detection.x_left_upper, 2);
+        ASSERT_NEAR(ffDetection.y_left_upper, detection.y_left_upper, 2);
+        ASSERT_NEAR(ffDetection.width, detection.width, 2);
+        ASSERT_NEAR(ffDetection.height, detection.height, 2);
+    }
+}
@@ -25,8 +25,15 @@
  ******************************************************************************/
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <map>
+#include <numeric>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -34,14 +41,22 @@
 #include <opencv2/opencv.hpp>
 
 
+#include "BlockingQueue.h"
 #include "detectionComponentUtils.h"
 #include "FeedForwardFrameFilter.h"
+#include "FramePool.h"
 #include <frame_transformers/SearchRegion.h>
 #include "MPFImageReader.h"
 #include "MPFVideoCapture.h"
 #include "MPFAsyncVideoCapture.h"
+#include "ParallelVideoCapture.h"
+#include "WorkStealingFrameDispatcher.h"
 #include "IntervalFrameFilter.h"
+#include "KeyFrameIndex.h"
 #include "MPFRotatedRect.h"
+#include "NonMaximumSuppression.h"
+#include "SeekCostModel.h"
+#include "SeekStatistics.h"
 
 
 using namespace MPF::COMPONENT;
@@ -454,6 +469,174 @@ TEST(FrameFilterTest, CanHandleStartStopFrameWithInterval) {
 }
 
 
+TEST(FrameFilterTest, CanReadBatch) {
+    auto cap = CreateVideoCapture(5, 26, 3);
+    ASSERT_EQ(cap.GetFrameCount(), 8);
+
+    std::vector<cv::Mat> frames;
+    ASSERT_EQ(cap.ReadBatch(frames, 3), 0);
+    ASSERT_EQ(frames.size(), 3);
+    ASSERT_EQ(GetFrameNumber(frames[0]), 5);
+    ASSERT_EQ(GetFrameNumber(frames[1]), 8);
+    ASSERT_EQ(GetFrameNumber(frames[2]), 11);
+
+    cv::Mat frame;
+    ASSERT_TRUE(cap.Read(frame));
+    ASSERT_EQ(GetFrameNumber(frame), 14);
+
+    // Only 4 frames remain in the segment.
+    ASSERT_EQ(cap.ReadBatch(frames, 10), 4);
+    ASSERT_EQ(frames.size(), 4);
+    ASSERT_EQ(GetFrameNumber(frames[0]), 17);
+    ASSERT_EQ(GetFrameNumber(frames[3]), 26);
+
+    ASSERT_EQ(cap.ReadBatch(frames, 10), -1);
+    ASSERT_TRUE(frames.empty());
+    assertReadFails(cap);
+}
+
+
+TEST(FrameFilterTest, ReadBatchAppliesFrameTransformers) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 0, 29,
+                    {{"SEARCH_REGION_ENABLE_DETECTION", "true"},
+                     {"SEARCH_REGION_TOP_LEFT_X_DETECTION", "3"},
+                     {"SEARCH_REGION_BOTTOM_RIGHT_X_DETECTION", "20"}}, {});
+    MPFVideoCapture batchCap(job);
+    MPFVideoCapture cap(job);
+
+    std::vector<cv::Mat> frames;
+    int firstIndex = 0;
+    while ((firstIndex = batchCap.ReadBatch(frames, 7)) >= 0) {
+        for (size_t i = 0; i < frames.size(); i++) {
+            ASSERT_EQ(cap.GetCurrentFramePosition(), firstIndex + static_cast<int>(i));
+            cv::Mat frame;
+            ASSERT_TRUE(cap.Read(frame));
+            ASSERT_EQ(frames[i].size(), cv::Size(17, frame.rows));
+            ASSERT_TRUE(isSameImage(frames[i], frame));
+        }
+    }
+    assertReadFails(cap);
+}
+
+
+TEST(FrameFilterTest, CompactCopyCropPolicyOnlyKeepsRegionOfInterest) {
+    Properties jobProperties {
+            {"SEARCH_REGION_ENABLE_DETECTION", "true"},
+            {"SEARCH_REGION_TOP_LEFT_X_DETECTION", "3"},
+            {"SEARCH_REGION_TOP_LEFT_Y_DETECTION", "3"},
+            {"SEARCH_REGION_BOTTOM_RIGHT_X_DETECTION", "20"},
+            {"SEARCH_REGION_BOTTOM_RIGHT_Y_DETECTION", "8"}};
+    MPFVideoCapture viewCap({"Test", frameFilterTestVideo, 0, 29, jobProperties, {}});
+    jobProperties["CROP_POLICY"] = "COMPACT_COPY";
+    MPFVideoCapture compactCap({"Test", frameFilterTestVideo, 0, 29, jobProperties, {}});
+
+    cv::Mat viewFrame;
+    cv::Mat compactFrame;
+    while (viewCap.Read(viewFrame)) {
+        ASSERT_TRUE(compactCap.Read(compactFrame));
+        ASSERT_EQ(compactFrame.size(), cv::Size(17, 5));
+        ASSERT_TRUE(isSameImage(viewFrame, compactFrame));
+
+        size_t regionBytes = compactFrame.total() * compactFrame.elemSize();
+        ASSERT_TRUE(compactFrame.isContinuous());
+        ASSERT_EQ(compactFrame.dataend - compactFrame.datastart, regionBytes);
+        ASSERT_EQ(compactFrame.allocator, &FramePool::GetInstance());
+        ASSERT_GT(viewFrame.dataend - viewFrame.datastart, regionBytes);
+    }
+    assertReadFails(compactCap);
+}
+
+
+TEST(FrameFilterTest, AsyncVideoCaptureCanReadBatch) {
+    MPFAsyncVideoCapture cap(CreateVideoJob(5, 26, 3));
+
+    std::vector<int> expectedFrameNumbers {5, 8, 11, 14, 17, 20, 23, 26};
+    std::vector<int> actualFrameNumbers;
+    int expectedIndex = 0;
+    std::vector<MPFFrame> frames;
+    while (!(frames = cap.ReadBatch(3)).empty()) {
+        ASSERT_LE(frames.size(), 3);
+        for (const auto &frame : frames) {
+            ASSERT_EQ(frame.index, expectedIndex);
+            expectedIndex++;
+            actualFrameNumbers.push_back(GetFrameNumber(frame.data));
+        }
+    }
+    ASSERT_EQ(actualFrameNumbers, expectedFrameNumbers);
+    ASSERT_FALSE(cap.Read().has_value());
+    ASSERT_TRUE(cap.ReadBatch(3).empty());
+}
+
+
+TEST(FramePoolTest, FramesAreRecycled) {
+    MPFVideoCapture cap({"Test", frameFilterTestVideo, 0, 29, {{"USE_FRAME_POOL", "true"}}, {}});
+    auto &framePool = FramePool::GetInstance();
+    framePool.Clear();
+
+    {
+        std::vector<cv::Mat> frames(3);
+        for (auto &frame : frames) {
+            ASSERT_TRUE(cap.Read(frame));
+            ASSERT_EQ(frame.allocator, &framePool);
+            ASSERT_EQ(reinterpret_cast<uintptr_t>(frame.data) % 4096, 0);
+        }
+    }
+    auto statsAfterFirstRead = framePool.GetStats();
+
+    for (int i = 0; i < 5; i++) {
+        std::vector<cv::Mat> frames(3);
+        for (auto &frame : frames) {
+            ASSERT_TRUE(cap.Read(frame));
+        }
+    }
+    auto statsAfterSteadyState = framePool.GetStats();
+
+    ASSERT_EQ(statsAfterFirstRead.allocationCount, statsAfterSteadyState.allocationCount);
+    ASSERT_EQ(statsAfterSteadyState.hitCount - statsAfterFirstRead.hitCount, 15);
+    ASSERT_GT(statsAfterSteadyState.GetHitRate(), 0.5);
+}
+
+
+TEST(FramePoolTest, ScaledFramesOnlyUsePoolWhenEnabled) {
+    auto &framePool = FramePool::GetInstance();
+    for (bool useFramePool : { false, true }) {
+        MPFVideoCapture cap({"Test", frameFilterTestVideo, 0, 29,
+                             {{"DECODE_MAX_DIMENSION", "16"},
+                              {"USE_FRAME_POOL", useFramePool ? "true" : "false"}}, {}});
+        ASSERT_LE(std::max(cap.GetFrameSize().width, cap.GetFrameSize().height), 16);
+        cv::Mat frame;
+        ASSERT_TRUE(cap.Read(frame));
+        ASSERT_EQ(cap.GetFrameSize(), frame.size());
+        ASSERT_EQ(useFramePool, frame.allocator == &framePool);
+    }
+}
+
+
+TEST(FramePoolTest, AsyncVideoCaptureRecyclesFrames) {
+    auto &framePool = FramePool::GetInstance();
+    framePool.Clear();
+    auto statsBefore = framePool.GetStats();
+
+    {
+        MPFAsyncVideoCapture cap({"Test", frameFilterTestVideo, 0, 29,
+                                  {{"USE_FRAME_POOL", "true"}, {"FRAME_QUEUE_CAPACITY", "4"}}, {}});
+        int expectedIndex = 0;
+        while (auto frame = cap.Read()) {
+            ASSERT_EQ(frame->index, expectedIndex);
+            ASSERT_EQ(GetFrameNumber(frame->data), expectedIndex);
+            expectedIndex++;
+        }
+        ASSERT_EQ(expectedIndex, 30);
+    }
+
+    auto statsAfter = framePool.GetStats();
+    // At most one buffer for each queue slot, one for the frame being decoded, one for the
+    // frame being emplaced in the queue, and one for the frame held by the consumer.
+    ASSERT_LE(statsAfter.allocationCount - statsBefore.allocationCount, 7);
+    ASSERT_GE(statsAfter.requestCount - statsBefore.requestCount, 30);
+}
+
+
 TEST(FrameFilterTest, CanNotSetPositionBeyondSegment) {
     auto cap = CreateVideoCapture(10, 15);
 
@@ -717,6 +900,220 @@ TEST(FrameFilterTest, AsyncVideoCaptureCanHandleFeedForwardTrack) {
 }
 
 
+TEST(FrameFilterTest, ParallelVideoCaptureAlignsChunksToKeyFrames) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 0, 29,
+                    {{"PARALLEL_CHUNK_SIZE", "4"}, {"PARALLEL_DECODER_COUNT", "3"}}, {});
+    ParallelVideoCapture cap(job);
+    ASSERT_EQ(cap.GetFrameCount(), 30);
+
+    std::vector<std::pair<int, int>> expectedChunks {
+            {0, 4}, {5, 9}, {10, 14}, {15, 19}, {20, 24}, {25, 29}
+    };
+    ASSERT_EQ(cap.GetChunks(), expectedChunks);
+
+    for (int i = 0; i < 30; i++) {
+        ASSERT_EQ(cap.GetCurrentFramePosition(), i);
+        auto frame = cap.Read();
+        ASSERT_TRUE(frame.has_value());
+        ASSERT_EQ(frame->index, i);
+        ASSERT_EQ(GetFrameNumber(frame->data), i);
+    }
+    ASSERT_FALSE(cap.Read().has_value());
+    ASSERT_FALSE(cap.Read().has_value());
+}
+
+
+TEST(FrameFilterTest, ParallelVideoCaptureMatchesVideoCapture) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 3, 27,
+                    {{"FRAME_INTERVAL", "2"},
+                     {"SEARCH_REGION_ENABLE_DETECTION", "true"},
+                     {"SEARCH_REGION_TOP_LEFT_X_DETECTION", "3"},
+                     {"PARALLEL_CHUNK_SIZE", "2"},
+                     {"PARALLEL_DECODER_COUNT", "4"},
+                     {"FRAME_QUEUE_CAPACITY", "1"}}, {});
+    ParallelVideoCapture parallelCap(job);
+    MPFVideoCapture cap(job);
+    ASSERT_EQ(parallelCap.GetFrameCount(), cap.GetFrameCount());
+    ASSERT_EQ(parallelCap.GetFrameSize(), cap.GetFrameSize());
+
+    cv::Mat expectedFrame;
+    while (cap.Read(expectedFrame)) {
+        auto frame = parallelCap.Read();
+        ASSERT_TRUE(frame.has_value());
+        ASSERT_EQ(frame->index, cap.GetCurrentFramePosition() - 1);
+        ASSERT_TRUE(isSameImage(frame->data, expectedFrame));
+    }
+    ASSERT_FALSE(parallelCap.Read().has_value());
+
+    MPFVideoTrack track(5, 10);
+    track.frame_locations = {
+            { 5, {20, 30, 15, 5} },
+            { 7, {20, 30, 15, 5} },
+            { 10, {20, 30, 15, 5} }
+    };
+    MPFVideoTrack expectedTrack = track;
+    parallelCap.ReverseTransform(track);
+    cap.ReverseTransform(expectedTrack);
+    ASSERT_EQ(track.start_frame, expectedTrack.start_frame);
+    ASSERT_EQ(track.stop_frame, expectedTrack.stop_frame);
+    assertMapContainsKeys(track.frame_locations, {13, 17, 23});
+    ASSERT_EQ(track.frame_locations.at(13).x_left_upper, expectedTrack.frame_locations.at(13).x_left_upper);
+}
+
+
+TEST(FrameFilterTest, CanDestroyParallelVideoCaptureBeforeReadingAllFrames) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 0, 29,
+                    {{"PARALLEL_CHUNK_SIZE", "3"}, {"PARALLEL_DECODER_COUNT", "2"}}, {});
+    ParallelVideoCapture cap(job);
+    auto frame = cap.Read();
+    ASSERT_TRUE(frame.has_value());
+    ASSERT_EQ(frame->index, 0);
+}
+
+
+TEST(FrameFilterTest, AsyncVideoCaptureCanUseLockFreeQueue) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 3, 27,
+                    {{"FRAME_INTERVAL", "2"}, {"USE_LOCK_FREE_FRAME_QUEUE", "true"},
+                     {"FRAME_QUEUE_CAPACITY", "2"}}, {});
+    MPFAsyncVideoCapture cap(job);
+    ASSERT_EQ(cap.GetFrameCount(), 13);
+
+    for (int i = 0; i < 5; i++) {
+        assertFrameRead(cap, 3 + 2 * i, i, cap.GetFrameSize());
+    }
+    // ReadBatch only returns frames that are already in the queue, so each call returns at most
+    // FRAME_QUEUE_CAPACITY frames.
+    int expectedIndex = 5;
+    std::vector<MPFFrame> frames;
+    while (!(frames = cap.ReadBatch(100)).empty()) {
+        ASSERT_LE(frames.size(), 2);
+        for (const auto &frame : frames) {
+            ASSERT_EQ(frame.index, expectedIndex);
+            ASSERT_EQ(GetFrameNumber(frame.data), 3 + 2 * expectedIndex);
+            expectedIndex++;
+        }
+    }
+    ASSERT_EQ(expectedIndex, 13);
+    ASSERT_FALSE(cap.Read().has_value());
+    ASSERT_TRUE(cap.ReadBatch(100).empty());
+}
+
+
+TEST(FrameFilterTest, CanDestroyAsyncVideoCaptureWithFullLockFreeQueue) {
+    MPFAsyncVideoCapture cap(frameFilterTestVideo, 1, true);
+    auto frame = cap.Read();
+    ASSERT_TRUE(frame.has_value());
+    ASSERT_EQ(frame->index, 0);
+}
+
+
+TEST(FrameFilterTest, AsyncVideoCaptureAdaptiveQueueStaysWithinMemoryBudget) {
+    cv::Size frameSize = MPFVideoCapture(frameFilterTestVideo).GetFrameSize();
+    auto frameBytes = frameSize.area() * 3;
+    auto maxBytes = 2 * frameBytes;
+    MPFAsyncVideoCapture cap({"Test", frameFilterTestVideo, 0, 29,
+                              {{"ADAPTIVE_FRAME_QUEUE_CAPACITY", "true"},
+                               {"FRAME_QUEUE_CAPACITY", "8"},
+                               {"FRAME_QUEUE_MAX_BYTES", std::to_string(maxBytes)}}, {});
+
+    int expectedIndex = 0;
+    while (auto frame = cap.Read()) {
+        ASSERT_EQ(frame->index, expectedIndex);
+        ASSERT_EQ(GetFrameNumber(frame->data), expectedIndex);
+        expectedIndex++;
+    }
+    ASSERT_EQ(expectedIndex, 30);
+
+    auto metrics = cap.GetFrameQueueMetrics();
+    ASSERT_GE(metrics.capacity, 1);
+    ASSERT_LE(metrics.capacity, 2);
+    // The initial capacity of 8 does not fit in the budget, so it is reduced before any frames
+    // are queued.
+    ASSERT_LE(metrics.peakCapacity * frameBytes, maxBytes);
+    ASSERT_GE(metrics.producerStallSeconds, 0);
+    ASSERT_GT(metrics.consumerStallSeconds, 0);
+}
+
+
+TEST(FrameFilterTest, AsyncVideoCaptureTransformThreadsMatchVideoCapture) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 3, 27,
+                    {{"FRAME_INTERVAL", "2"},
+                     {"ROTATION", "30"},
+                     {"SEARCH_REGION_ENABLE_DETECTION", "true"},
+                     {"SEARCH_REGION_TOP_LEFT_X_DETECTION", "3"},
+                     {"TRANSFORM_THREADS", "3"},
+                     {"FRAME_QUEUE_CAPACITY", "2"}}, {});
+    MPFAsyncVideoCapture asyncCap(job);
+    MPFVideoCapture cap(job);
+    ASSERT_EQ(asyncCap.GetFrameSize(), cap.GetFrameSize());
+
+    cv::Mat expectedFrame;
+    while (cap.Read(expectedFrame)) {
+        auto frame = asyncCap.Read();
+        ASSERT_TRUE(frame.has_value());
+        ASSERT_EQ(frame->index, cap.GetCurrentFramePosition() - 1);
+        ASSERT_TRUE(isSameImage(frame->data, expectedFrame));
+    }
+    ASSERT_FALSE(asyncCap.Read().has_value());
+}
+
+
+TEST(FrameFilterTest, CanDestroyAsyncVideoCaptureWithTransformThreads) {
+    MPFAsyncVideoCapture cap({"Test", frameFilterTestVideo, 0, 29,
+                              {{"ROTATION", "90"}, {"TRANSFORM_THREADS", "2"},
+                               {"FRAME_QUEUE_CAPACITY", "1"}}, {}});
+    auto frame = cap.Read();
+    ASSERT_TRUE(frame.has_value());
+    ASSERT_EQ(frame->index, 0);
+}
+
+
+TEST(FrameFilterTest, WorkStealingFrameDispatcherReturnsEachFrameOnce) {
+    MPFAsyncVideoCapture cap({"Test", frameFilterTestVideo, 0, 29, {{"USE_LOCK_FREE_FRAME_QUEUE", "true"}}, {}});
+    WorkStealingFrameDispatcher dispatcher(cap, 3, 2);
+    OrderedFrameResults<int> frameNumbers;
+
+    std::vector<std::thread> workers;
+    for (int workerIndex = 0; workerIndex < dispatcher.GetWorkerCount(); workerIndex++) {
+        workers.emplace_back([&, workerIndex] {
+            while (auto frame = dispatcher.Read(workerIndex)) {
+                if (workerIndex == 0) {
+                    // Slow down one worker so that the others need to steal its frames.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                }
+                frameNumbers.Add(frame->index, GetFrameNumber(frame->data));
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    auto orderedFrameNumbers = frameNumbers.TakeReady();
+    ASSERT_EQ(orderedFrameNumbers.size(), 30);
+    for (int i = 0; i < 30; i++) {
+        ASSERT_EQ(orderedFrameNumbers[i], i);
+    }
+    ASSERT_EQ(frameNumbers.GetNextFrameIndex(), 30);
+    ASSERT_FALSE(dispatcher.Read(1).has_value());
+}
+
+
+TEST(OrderedFrameResultsTest, ReleasesResultsInFrameOrder) {
+    OrderedFrameResults<std::string> results;
+    results.Add(1, "b");
+    ASSERT_TRUE(results.TakeReady().empty());
+
+    results.Add(0, "a");
+    results.Add(3, "d");
+    ASSERT_EQ(results.TakeReady(), std::vector<std::string>({"a", "b"}));
+
+    results.Add(2, "c");
+    ASSERT_EQ(results.TakeReady(), std::vector<std::string>({"c", "d"}));
+    ASSERT_EQ(results.GetNextFrameIndex(), 4);
+}
+
+
 TEST(FrameFilterTest, CanUseSearchRegionWithFeedForwardFrameType) {
     MPFVideoTrack feedForwardTrack(0, 15);
     feedForwardTrack.frame_locations = {
@@ -853,6 +1250,46 @@ TEST(FrameFilterTest, CanSetFramePositionOnTSFile) {
 }
 
 
+void assertMultiThreadedDecodeMatchesSingleThreaded(const std::string &videoPath) {
+    MPFVideoCapture singleThreadCap({"Test", videoPath, 0, -1, {{"DECODE_THREADS", "1"}}, {}});
+    MPFVideoCapture multiThreadCap({"Test", videoPath, 0, -1, {{"DECODE_THREADS", "4"}}, {}});
+    ASSERT_EQ(singleThreadCap.GetFrameCount(), multiThreadCap.GetFrameCount());
+
+    int framesRead = 0;
+    cv::Mat singleThreadFrame;
+    cv::Mat multiThreadFrame;
+    while (singleThreadCap.Read(singleThreadFrame)) {
+        ASSERT_TRUE(multiThreadCap.Read(multiThreadFrame)) << "Failed to read frame " << framesRead;
+        ASSERT_TRUE(isSameImage(singleThreadFrame, multiThreadFrame)) << "Frame " << framesRead << " differs";
+        framesRead++;
+    }
+    ASSERT_FALSE(multiThreadCap.Read(multiThreadFrame));
+    ASSERT_EQ(framesRead, singleThreadCap.GetFrameCount());
+}
+
+
+TEST(FrameFilterTest, MultiThreadedDecodeMatchesSingleThreadedDecode) {
+    assertMultiThreadedDecodeMatchesSingleThreaded(frameFilterTestVideo);
+    assertMultiThreadedDecodeMatchesSingleThreaded("test/test_vids/bbb24p_00_short.ts");
+}
+
+
+TEST(FrameFilterTest, AsyncVideoCaptureCanUseMultiThreadedDecode) {
+    MPFAsyncVideoCapture cap(CreateVideoJob(0, 29, 2));
+    MPFAsyncVideoCapture multiThreadCap(
+            {"Test", frameFilterTestVideo, 0, 29, {{"FRAME_INTERVAL", "2"}, {"DECODE_THREADS", "0"}}, {}});
+    ASSERT_EQ(cap.GetFrameCount(), multiThreadCap.GetFrameCount());
+
+    while (auto frame = cap.Read()) {
+        auto multiThreadFrame = multiThreadCap.Read();
+        ASSERT_TRUE(multiThreadFrame.has_value());
+        ASSERT_EQ(frame->index, multiThreadFrame->index);
+        ASSERT_TRUE(isSameImage(frame->data, multiThreadFrame->data));
+    }
+    ASSERT_FALSE(multiThreadCap.Read().has_value());
+}
+
+
 void assertCanChangeFramePosition(const SeekStrategy& seekStrategy) {
     cv::VideoCapture cap(frameFilterTestVideo);
     int framePosition = 0;
@@ -895,6 +1332,120 @@ TEST(FrameFilterTest, TestReadSeek) {
 }
 
 
+TEST(FrameFilterTest, TestIndexedSeek) {
+    assertCanChangeFramePosition(IndexedSeek(frameFilterTestVideo, false));
+}
+
+
+TEST(FrameFilterTest, SetFramePositionSeekUsesKeyFramesToPlanLongJumps) {
+    auto keyFrameIndex = std::make_shared<const LazyKeyFrameIndex>(frameFilterTestVideo, false);
+    SetFramePositionSeek seekStrategy(nullptr, keyFrameIndex, true);
+    assertCanChangeFramePosition(seekStrategy);
+
+    // The key frames are every 5 frames. To get to frame 28, OpenCV starts decoding at
+    // frame 10, so setting the frame position is better than grabbing 28 frames.
+    cv::VideoCapture cap(frameFilterTestVideo);
+    ASSERT_EQ(28, seekStrategy.ChangePosition(cap, 0, 28));
+    ASSERT_EQ(0, seekStrategy.GetFramesDecodedByLastSeek());
+    cv::Mat frame;
+    ASSERT_TRUE(cap.read(frame));
+    ASSERT_EQ(28, GetFrameNumber(frame));
+
+    // To get to frame 29 from frame 11, OpenCV would also start decoding at frame 10, so it is
+    // better to grab.
+    cv::VideoCapture cap2(frameFilterTestVideo);
+    ASSERT_EQ(11, seekStrategy.ChangePosition(cap2, 0, 11));
+    ASSERT_EQ(29, seekStrategy.ChangePosition(cap2, 11, 29));
+    ASSERT_EQ(18, seekStrategy.GetFramesDecodedByLastSeek());
+    ASSERT_TRUE(cap2.read(frame));
+    ASSERT_EQ(29, GetFrameNumber(frame));
+}
+
+
+TEST(FrameFilterTest, IndexedSeekIsExactOnVfrVideo) {
+    std::vector<cv::Mat> expectedFrames;
+    cv::VideoCapture sequentialCap(videoWithFramePositionIssues);
+    cv::Mat frame;
+    while (sequentialCap.read(frame)) {
+        expectedFrames.push_back(frame.clone());
+    }
+    ASSERT_GT(expectedFrames.size(), 60u);
+
+    IndexedSeek seekStrategy(videoWithFramePositionIssues, false);
+    cv::VideoCapture cap(videoWithFramePositionIssues);
+    int framePosition = 0;
+    for (int requestedPosition : { 40, 10, 55, 54, 3, 60 }) {
+        framePosition = seekStrategy.ChangePosition(cap, framePosition, requestedPosition);
+        ASSERT_EQ(requestedPosition, framePosition);
+        ASSERT_TRUE(cap.read(frame));
+        ASSERT_TRUE(isSameImage(expectedFrames.at(requestedPosition), frame))
+            << "Incorrect frame read after seeking to frame " << requestedPosition;
+        framePosition++;
+    }
+}
+
+
+TEST(FrameFilterTest, SeekCostModelPicksCheaperWayToMoveForward) {
+    SeekCostModel model;
+    // Until both costs are known, it grabs when moving the same distance as OpenCV would when
+    // setting the frame position.
+    ASSERT_TRUE(model.ShouldGrab(SeekCostModel::DEFAULT_MAX_GRAB_FRAMES));
+    ASSERT_FALSE(model.ShouldGrab(SeekCostModel::DEFAULT_MAX_GRAB_FRAMES + 1));
+
+    model.AddGrabSample(10, 20);
+    ASSERT_DOUBLE_EQ(2, model.GetGrabMillisPerFrame());
+    ASSERT_FALSE(model.ShouldGrab(SeekCostModel::DEFAULT_MAX_GRAB_FRAMES + 1));
+
+    model.AddSetPositionSample(100);
+    ASSERT_TRUE(model.ShouldGrab(50));
+    ASSERT_FALSE(model.ShouldGrab(51));
+
+    // Setting the frame position got slower, so it is worth grabbing further.
+    model.AddSetPositionSample(200);
+    ASSERT_DOUBLE_EQ(120, model.GetSetPositionMillis());
+    ASSERT_TRUE(model.ShouldGrab(60));
+
+    ASSERT_EQ(SeekCostModel::GetForVideo(frameFilterTestVideo),
+              SeekCostModel::GetForVideo(frameFilterTestVideo));
+}
+
+
+TEST(FrameFilterTest, RecordsSeekStatistics) {
+    std::string statsPath = (std::filesystem::temp_directory_path() / "mpf_seek_statistics.json").string();
+    std::filesystem::remove(statsPath);
+    {
+        MPFVideoCapture cap({"Test", frameFilterTestVideo, 0, 29,
+                             {{"FRAME_INTERVAL", "10"}, {"SEEK_STATISTICS_FILE", statsPath}}, {}});
+        assertExpectedFramesShown(cap, {0, 10, 20});
+        ASSERT_TRUE(cap.SetFramePosition(0));
+
+        const SeekStatistics &stats = cap.GetSeekStatistics();
+        ASSERT_EQ(frameFilterTestVideo, stats.GetVideoPath());
+        ASSERT_TRUE(stats.GetFallbacks().empty());
+        ASSERT_FALSE(stats.GetSeeks().empty());
+        const SeekStatistics::Seek &lastSeek = stats.GetSeeks().back();
+        ASSERT_EQ(0, lastSeek.requestedFrame);
+        ASSERT_EQ(0, lastSeek.resultFrame);
+
+        std::size_t seekCount = 0;
+        for (const auto &[strategy, totals] : stats.GetTotals()) {
+            ASSERT_EQ(0, totals.failedSeekCount) << strategy;
+            seekCount += totals.seekCount;
+        }
+        ASSERT_EQ(stats.GetSeeks().size(), seekCount);
+        ASSERT_FALSE(std::filesystem::exists(statsPath));
+    }
+
+    std::ifstream statsFile(statsPath);
+    std::string line;
+    ASSERT_TRUE(std::getline(statsFile, line));
+    ASSERT_EQ(0, line.find("{\"videoPath\":\"test/test_vids/frame_filter_test.mp4\""));
+    ASSERT_NE(std::string::npos, line.find("\"seeks\":[{"));
+    ASSERT_FALSE(std::getline(statsFile, line));
+    std::filesystem::remove(statsPath);
+}
+
+
 TEST(FrameFilterTest, CanFilterOnKeyFrames) {
     MPFVideoJob job("Test", frameFilterTestVideo, 0, 1000, {{"USE_KEY_FRAMES", "true"}}, {});
     MPFVideoCapture cap(job);
@@ -932,6 +1483,86 @@ TEST(FrameFilterTest, CanFilterOnKeyFramesAndStartStopFrameAndInterval) {
 }
 
 
+TEST(FrameFilterTest, KeyFrameIndexIsCachedNextToVideo) {
+    std::filesystem::path tempDir = std::filesystem::temp_directory_path() / "mpf_key_frame_index_test";
+    std::filesystem::remove_all(tempDir);
+    std::filesystem::create_directories(tempDir);
+    std::string videoPath = (tempDir / "video.mp4").string();
+    std::filesystem::copy_file(frameFilterTestVideo, videoPath);
+    std::string cachePath = KeyFrameIndex::GetCachePath(videoPath);
+    ASSERT_EQ((tempDir / ".video.mp4.keyframes").string(), cachePath);
+
+    KeyFrameIndex::ClearMemoryCache();
+    std::vector<int> expectedKeyFrames {0, 5, 10, 15, 20, 25};
+    ASSERT_EQ(expectedKeyFrames, *KeyFrameIndex::Get(videoPath));
+    ASSERT_TRUE(std::filesystem::exists(cachePath));
+
+    // Replace the key frames in the cache file to show that later jobs use it instead of the video.
+    std::string header;
+    std::string size;
+    std::string modificationTime;
+    {
+        std::ifstream cacheFile(cachePath);
+        cacheFile >> header >> size >> modificationTime;
+    }
+    {
+        std::ofstream cacheFile(cachePath);
+        cacheFile << header << ' ' << size << ' ' << modificationTime << " 2\n0 0\n10 400\n";
+    }
+    KeyFrameIndex::ClearMemoryCache();
+    ASSERT_EQ(std::vector<int>({0, 10}), *KeyFrameIndex::Get(videoPath));
+
+    MPFVideoJob job("Test", videoPath, 0, 1000, {{"USE_KEY_FRAMES", "true"}}, {});
+    MPFVideoCapture cap(job);
+    assertExpectedFramesShown(cap, {0, 10});
+
+    // The cached index is ignored once the video changes.
+    std::filesystem::last_write_time(
+            videoPath, std::filesystem::last_write_time(videoPath) + std::chrono::seconds(1));
+    ASSERT_EQ(expectedKeyFrames, *KeyFrameIndex::Get(videoPath));
+
+    std::filesystem::remove_all(tempDir);
+}
+
+
+TEST(FrameFilterTest, KeyFrameIndexIsOnlyLoadedOnceWhenRequestedConcurrently) {
+    KeyFrameIndex::ClearMemoryCache();
+    std::shared_ptr<const KeyFrameIndex::KeyFrames> results[4];
+    std::vector<std::thread> threads;
+    for (auto &result : results) {
+        threads.emplace_back([&result] {
+            result = KeyFrameIndex::GetWithTimes(frameFilterTestVideo, false);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    // The threads that did not run ffprobe got the index that the first thread loaded.
+    for (const auto &result : results) {
+        ASSERT_EQ(results[0], result);
+    }
+    ASSERT_EQ(std::vector<int>({0, 5, 10, 15, 20, 25}), results[0]->frameNumbers);
+}
+
+
+TEST(FrameFilterTest, KeyFrameIndexSkipsDiscardedPackets) {
+    // An MP4 edit list that starts after a key frame makes the demuxer mark the packets before
+    // the start as discard. The decoder drops them, so they are not frames.
+    std::stringstream ffprobeOutput(
+            "-0.080000,-0.080000,KD_\n"
+            "-0.040000,-0.040000,_D_\n"
+            "0.000000,0.000000,___\n"
+            "0.080000,0.040000,___\n"
+            "0.040000,0.080000,___\n"
+            "0.120000,0.120000,K__\n"
+            "0.160000,0.160000,___\n");
+    KeyFrameIndex::KeyFrames keyFrames = KeyFrameIndex::ParsePackets(ffprobeOutput);
+    ASSERT_EQ(std::vector<int>({3}), keyFrames.frameNumbers);
+    ASSERT_EQ(1u, keyFrames.timesInMillis.size());
+    ASSERT_NEAR(120, keyFrames.timesInMillis[0], 0.001);
+}
+
+
 /**
  * Creates the frame_filter_test.avi video.
  */
@@ -1037,6 +1668,35 @@ void assertDetectionLocationsMatch(const MPFImageLocation &loc1, const MPFImageL
 }
 
 
+TEST(ReverseTransformTest, CanReverseTransformIndividualDetections) {
+    MPFVideoJob job("Test", frameFilterTestVideo, 5, 19, {
+            { "FRAME_INTERVAL", "2" },
+            { "SEARCH_REGION_ENABLE_DETECTION", "true" },
+            { "SEARCH_REGION_TOP_LEFT_X_DETECTION", "3"},
+            { "SEARCH_REGION_TOP_LEFT_Y_DETECTION", "4"}
+    }, {});
+    MPFVideoCapture cap(job);
+    ReverseTransformer reverseTransformer = cap.GetReverseTransformer();
+
+    MPFImageLocation trackDetection(20, 30, 15, 5);
+    MPFVideoTrack track(6, 6);
+    track.frame_locations.emplace(6, trackDetection);
+    cap.ReverseTransform(track);
+
+    MPFImageLocation capDetection(20, 30, 15, 5);
+    ASSERT_EQ(17, cap.ReverseTransform(capDetection, 6));
+
+    MPFImageLocation detection(20, 30, 15, 5);
+    ASSERT_EQ(17, reverseTransformer(detection, 6));
+
+    const MPFImageLocation &expected = track.frame_locations.at(17);
+    ASSERT_EQ(23, expected.x_left_upper);
+    ASSERT_EQ(34, expected.y_left_upper);
+    assertDetectionLocationsMatch(expected, capDetection);
+    assertDetectionLocationsMatch(expected, detection);
+}
+
+
 TEST(FeedForwardFrameCropperTest, CanCropToExactRegion) {
     MPFVideoTrack feedForwardTrack(4, 29, 1, {});
     feedForwardTrack.frame_locations = {
@@ -1177,3 +1837,182 @@ TEST(SearchRegion, TestSearchRegion) {
             });
 }
 
+
+
+TEST(BlockingQueueTest, CanPushRangeAndPopMany) {
+    BlockingQueue<int> queue(3);
+    std::vector<int> input{0, 1, 2, 3, 4, 5, 6};
+
+    std::thread producer([&] {
+        queue.push_range(input.begin(), input.end());
+        queue.complete_adding();
+    });
+
+    std::vector<int> output;
+    try {
+        while (true) {
+            ASSERT_LE(queue.size(), 3);
+            queue.pop_many(output, 2);
+        }
+    }
+    catch (const QueueHaltedException&) { }
+    producer.join();
+
+    ASSERT_EQ(input, output);
+    ASSERT_EQ(queue.size(), 0);
+}
+
+
+TEST(BlockingQueueTest, TryPopTimesOut) {
+    BlockingQueue<int> queue(2);
+    ASSERT_FALSE(queue.try_pop(std::chrono::milliseconds(10)).has_value());
+
+    queue.push(5);
+    ASSERT_EQ(queue.size(), 1);
+    ASSERT_EQ(queue.try_pop(std::chrono::milliseconds(10)), 5);
+    ASSERT_EQ(queue.size(), 0);
+
+    queue.complete_adding();
+    ASSERT_THROW(queue.try_pop(std::chrono::milliseconds(10)), QueueHaltedException);
+}
+
+
+// Contention microbenchmark: several producers and consumers share a small queue. Verifies that
+// every item is received exactly once and records the throughput in the test report.
+TEST(BlockingQueueTest, MultiProducerMultiConsumerContention) {
+    constexpr int numProducers = 4;
+    constexpr int numConsumers = 4;
+    constexpr int itemsPerProducer = 50'000;
+    BlockingQueue<int> queue(16);
+
+    std::atomic<int> numProducersRunning(numProducers);
+    std::atomic<long long> consumedSum(0);
+    std::atomic<int> consumedCount(0);
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < numProducers; p++) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < itemsPerProducer; i++) {
+                queue.push(p * itemsPerProducer + i);
+            }
+            if (--numProducersRunning == 0) {
+                queue.complete_adding();
+            }
+        });
+    }
+    for (int c = 0; c < numConsumers; c++) {
+        threads.emplace_back([&] {
+            long long sum = 0;
+            int count = 0;
+            try {
+                while (true) {
+                    sum += queue.pop();
+                    count++;
+                }
+            }
+            catch (const QueueHaltedException&) { }
+            consumedSum += sum;
+            consumedCount += count;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime);
+
+    long long numItems = numProducers * itemsPerProducer;
+    ASSERT_EQ(consumedCount, numItems);
+    ASSERT_EQ(consumedSum, numItems * (numItems - 1) / 2);
+    ::testing::Test::RecordProperty(
+            "ItemsPerSecond", static_cast<int>(numItems * 1'000'000 / std::max<long long>(1, elapsed.count())));
+}
+
+
+TEST(NonMaximumSuppressionTest, RotatedIouMatchesAxisAlignedIou) {
+    cv::Rect2d rect1(0, 0, 10, 10);
+    cv::Rect2d rect2(5, 0, 10, 10);
+    ASSERT_DOUBLE_EQ(1.0 / 3, IntersectionOverUnion(rect1, rect2));
+    ASSERT_DOUBLE_EQ(1.0 / 3, IntersectionOverUnion(MPFRotatedRect(0, 0, 10, 10, 0),
+                                                    MPFRotatedRect(5, 0, 10, 10, 360)));
+
+    // Rotating 90 degrees counter-clockwise around the top left corner moves the rectangle
+    // above its original position.
+    ASSERT_NEAR(1, IntersectionOverUnion(MPFRotatedRect(0, 0, 10, 10, 90),
+                                         MPFRotatedRect(0, -10, 10, 10)), 1e-9);
+    ASSERT_NEAR(0, IntersectionOverUnion(MPFRotatedRect(0, 0, 10, 10, 90),
+                                         MPFRotatedRect(0, 0, 10, 10)), 1e-9);
+    // Flipping moves the rectangle to the left of its original position.
+    ASSERT_NEAR(1.0 / 3, IntersectionOverUnion(MPFRotatedRect(5, 0, 10, 10, 0, true),
+                                               MPFRotatedRect(0, 0, 10, 10)), 1e-9);
+    ASSERT_NEAR(1, IntersectionOverUnion(MPFRotatedRect(3, 4, 10, 20, 45, true),
+                                         MPFRotatedRect(3, 4, 10, 20, 45, true)), 1e-9);
+}
+
+
+TEST(NonMaximumSuppressionTest, MatchesExhaustiveComparison) {
+    cv::RNG rng(42);
+    std::vector<MPFRotatedRect> boxes;
+    std::vector<float> scores;
+    for (int i = 0; i < 2000; i++) {
+        boxes.emplace_back(rng.uniform(0.0, 1000.0), rng.uniform(0.0, 1000.0),
+                           rng.uniform(5.0, 60.0), rng.uniform(5.0, 60.0),
+                           rng.uniform(0.0, 360.0), i % 5 == 0);
+        scores.push_back(rng.uniform(0.0f, 1.0f));
+    }
+
+    std::vector<int> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&scores](int i1, int i2) {
+        return scores[i1] > scores[i2];
+    });
+    std::vector<int> expected;
+    for (int candidate : order) {
+        bool suppressed = std::any_of(expected.begin(), expected.end(), [&](int kept) {
+            return IntersectionOverUnion(boxes[candidate], boxes[kept]) > 0.3;
+        });
+        if (!suppressed) {
+            expected.push_back(candidate);
+        }
+    }
+
+    ASSERT_EQ(expected, NonMaximumSuppression(boxes, scores, 0.3));
+}
+
+
+TEST(NonMaximumSuppressionTest, SoftNmsDecaysOverlappingScores) {
+    std::vector<cv::Rect2d> boxes {
+            { 0, 0, 10, 10 },
+            { 5, 0, 10, 10 },
+            { 100, 100, 10, 10 }
+    };
+    std::vector<float> scores { 0.9f, 0.8f, 0.5f };
+
+    SoftNmsSettings settings;
+    settings.decay = SoftNmsDecay::LINEAR;
+    settings.iouThreshold = 0.3;
+    std::vector<int> kept = SoftNonMaximumSuppression(boxes, scores, settings);
+
+    ASSERT_EQ(std::vector<int>({ 0, 1, 2 }), kept);
+    ASSERT_FLOAT_EQ(0.9, scores[0]);
+    ASSERT_FLOAT_EQ(0.8 * 2 / 3, scores[1]);
+    ASSERT_FLOAT_EQ(0.5, scores[2]);
+}
+
+
+TEST(NonMaximumSuppressionTest, CanSuppressDetections) {
+    std::vector<MPFImageLocation> detections {
+            { 0, 0, 10, 10, 0.9f },
+            { 1, 0, 10, 10, 0.8f },
+            { 50, 50, 10, 10, 0.7f, { { "ROTATION", "45" } } },
+            { 50, 50, 10, 10, 0.95f, { { "ROTATION", "45" } } },
+            { 50, 50, 10, 10, 0.6f, { { "ROTATION", "225" } } }
+    };
+    NonMaximumSuppression(detections, 0.5);
+
+    ASSERT_EQ(3, detections.size());
+    ASSERT_FLOAT_EQ(0.9, detections[0].confidence);
+    ASSERT_FLOAT_EQ(0.95, detections[1].confidence);
+    ASSERT_FLOAT_EQ(0.6, detections[2].confidence);
+}
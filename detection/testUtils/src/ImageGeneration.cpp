@@ -152,6 +152,7 @@ namespace MPF { namespace COMPONENT {
         Mat src = blank_frame.clone();
 
         vector<Rect> random_rects;
+        RectIndex random_rect_index;
 
         for (unsigned int i = 0; i < objects.size(); i++) {
             Mat object = Mat(objects[i]);
@@ -162,9 +163,10 @@ namespace MPF { namespace COMPONENT {
             int intersection_index = -1;
             do {
                 random_rect = GetRandomRect(blank_frame, rect);
-            } while (Utils::IsExistingRectIntersection(random_rect, random_rects, intersection_index));
+            } while (Utils::IsExistingRectIntersection(random_rect, random_rect_index, intersection_index));
 
             random_rects.push_back(random_rect);
+            random_rect_index.Insert(random_rect);
             MPFImageLocation detection(random_rect.x, random_rect.y, random_rect.width, random_rect.height);
             detections.push_back(detection);
 
@@ -238,6 +238,7 @@ namespace MPF { namespace COMPONENT {
 
         vector<Rect> random_rects;
         vector<Rect> stepped_rects;
+        RectIndex initial_rect_index;
         vector<MPFVideoTrack> current_tracks;
 
         for (unsigned int i = 0; i < objects.size(); i++) {
@@ -249,10 +250,11 @@ namespace MPF { namespace COMPONENT {
             int intersection_index = -1;
             do {
                 random_rect = GetRandomRect(blank_frame, rect);
-            } while (Utils::IsExistingRectIntersection(random_rect, stepped_rects, intersection_index));
+            } while (Utils::IsExistingRectIntersection(random_rect, initial_rect_index, intersection_index));
 
             random_rects.push_back(random_rect);
             stepped_rects.push_back(random_rect);
+            initial_rect_index.Insert(random_rect);
 
             MPFVideoTrack track;
             track.start_frame = 0;
@@ -284,10 +286,12 @@ namespace MPF { namespace COMPONENT {
                     Rect rect = Rect(0, 0, object.cols, object.rows);
                     Rect random_rect;
 
+                    // stepped_rects does not change while retrying, so it is only indexed once.
+                    RectIndex stepped_rect_index(stepped_rects);
                     int intersection_index = -1;
                     do {
                         random_rect = GetRandomRect(blank_frame, rect);
-                    } while (Utils::IsExistingRectIntersection(random_rect, stepped_rects, intersection_index));
+                    } while (Utils::IsExistingRectIntersection(random_rect, stepped_rect_index, intersection_index));
 
                     stepped_rects[i] = random_rect;
                 }
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#ifndef OPENMPF_CPP_COMPONENT_SDK_RECTINDEX_H
+#define OPENMPF_CPP_COMPONENT_SDK_RECTINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+namespace MPF { namespace COMPONENT {
+
+    /**
+     * Uniform grid of rectangles for finding the rectangles that intersect a region or are nearest
+     * to a point without comparing against every rectangle. Each rectangle is stored in every
+     * cell that it overlaps, so the cell size should be close to the typical rectangle size.
+     */
+    class RectIndex {
+    public:
+        explicit RectIndex(int cellSize = DEFAULT_CELL_SIZE);
+
+        explicit RectIndex(const std::vector<cv::Rect> &rects, int cellSize = DEFAULT_CELL_SIZE);
+
+        /**
+         * @return The index of the rectangle, which is the number of rectangles inserted before it
+         */
+        int Insert(const cv::Rect &rect);
+
+        const cv::Rect& Get(int index) const;
+
+        std::size_t Size() const;
+
+        bool Empty() const;
+
+        /**
+         * @return Indices, in increasing order, of the rectangles whose intersection with rect has
+         *         a positive area
+         */
+        std::vector<int> QueryIntersecting(const cv::Rect &rect) const;
+
+        /**
+         * @return Index of the rectangle closest to point, or -1 when the index is empty. Points
+         *         inside a rectangle have a distance of 0 to it. Ties go to the lower index.
+         */
+        int QueryNearest(const cv::Point2d &point) const;
+
+
+        static constexpr int DEFAULT_CELL_SIZE = 64;
+
+    private:
+        const int cellSize_;
+
+        std::vector<cv::Rect> rects_;
+
+        std::unordered_map<std::int64_t, std::vector<int>> cells_;
+
+        // Range of cells that contain at least one rectangle.
+        cv::Point minCell_;
+        cv::Point maxCell_;
+
+        int ToCell(int coordinate) const;
+
+        static std::int64_t GetCellKey(int cellX, int cellY);
+
+        // Only cells that the rectangle's area overlaps. Empty rectangles are not stored in any cell.
+        cv::Rect GetCellRange(const cv::Rect &rect) const;
+    };
+}}
+
+#endif //OPENMPF_CPP_COMPONENT_SDK_RECTINDEX_H
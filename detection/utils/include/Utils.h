@@ -35,6 +35,7 @@
 
 #include "MPFDetectionComponent.h"
 #include "detectionComponentUtils.h"
+#include "RectIndex.h"
 
 
 namespace MPF { namespace COMPONENT { namespace Utils {
@@ -66,10 +67,18 @@ namespace MPF { namespace COMPONENT { namespace Utils {
 
     MPFImageLocation CvRectToImageLocation(const cv::Rect &rect, float confidence = -1.0f);
 
+    // Checks whether new_rect overlaps any of the existing rects, ignoring existing rects that are
+    // equal to new_rect. intersection_index is set to the lowest overlapping index, or -1.
     bool IsExistingRectIntersection(const cv::Rect new_rect,
                                     const std::vector<cv::Rect> &existing_rects,
                                     int &intersection_index);
 
+    // Same as above, but callers that check many rects against the same set should keep a
+    // RectIndex so that each check only looks at nearby rects.
+    bool IsExistingRectIntersection(const cv::Rect &new_rect,
+                                    const RectIndex &existing_rects,
+                                    int &intersection_index);
+
     void DrawText(cv::Mat &image, int frame_index);
 
     void DrawTracks(cv::Mat &image,
@@ -0,0 +1,221 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include "RectIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+
+namespace MPF { namespace COMPONENT {
+
+    namespace {
+        double GetDistance(const cv::Rect &rect, const cv::Point2d &point) {
+            double dx = std::max({ rect.x - point.x, 0.0, point.x - (rect.x + rect.width) });
+            double dy = std::max({ rect.y - point.y, 0.0, point.y - (rect.y + rect.height) });
+            return std::sqrt(dx * dx + dy * dy);
+        }
+    }
+
+
+    RectIndex::RectIndex(int cellSize)
+        : cellSize_(cellSize)
+        , minCell_(std::numeric_limits<int>::max(), std::numeric_limits<int>::max())
+        , maxCell_(std::numeric_limits<int>::min(), std::numeric_limits<int>::min())
+    {
+        if (cellSize <= 0) {
+            throw std::invalid_argument(
+                    "RectIndex cell size must be positive, but it was " + std::to_string(cellSize) + '.');
+        }
+    }
+
+
+    RectIndex::RectIndex(const std::vector<cv::Rect> &rects, int cellSize)
+        : RectIndex(cellSize)
+    {
+        rects_.reserve(rects.size());
+        for (const auto &rect : rects) {
+            Insert(rect);
+        }
+    }
+
+
+    int RectIndex::Insert(const cv::Rect &rect) {
+        int index = static_cast<int>(rects_.size());
+        rects_.push_back(rect);
+
+        cv::Rect cellRange = GetCellRange(rect);
+        if (cellRange.empty()) {
+            return index;
+        }
+        for (int cellY = cellRange.y; cellY < cellRange.y + cellRange.height; cellY++) {
+            for (int cellX = cellRange.x; cellX < cellRange.x + cellRange.width; cellX++) {
+                cells_[GetCellKey(cellX, cellY)].push_back(index);
+            }
+        }
+        minCell_.x = std::min(minCell_.x, cellRange.x);
+        minCell_.y = std::min(minCell_.y, cellRange.y);
+        maxCell_.x = std::max(maxCell_.x, cellRange.x + cellRange.width - 1);
+        maxCell_.y = std::max(maxCell_.y, cellRange.y + cellRange.height - 1);
+        return index;
+    }
+
+
+    const cv::Rect& RectIndex::Get(int index) const {
+        return rects_.at(index);
+    }
+
+
+    std::size_t RectIndex::Size() const {
+        return rects_.size();
+    }
+
+
+    bool RectIndex::Empty() const {
+        return rects_.empty();
+    }
+
+
+    std::vector<int> RectIndex::QueryIntersecting(const cv::Rect &rect) const {
+        std::vector<int> result;
+        cv::Rect cellRange = GetCellRange(rect);
+        for (int cellY = cellRange.y; cellY < cellRange.y + cellRange.height; cellY++) {
+            for (int cellX = cellRange.x; cellX < cellRange.x + cellRange.width; cellX++) {
+                auto cellIter = cells_.find(GetCellKey(cellX, cellY));
+                if (cellIter == cells_.end()) {
+                    continue;
+                }
+                for (int index : cellIter->second) {
+                    if ((rects_[index] & rect).area() > 0) {
+                        result.push_back(index);
+                    }
+                }
+            }
+        }
+        // Rectangles that span more than one cell are found more than once.
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+
+    int RectIndex::QueryNearest(const cv::Point2d &point) const {
+        int bestIndex = -1;
+        double bestDistance = std::numeric_limits<double>::max();
+        auto checkRect = [&](int index) {
+            double distance = GetDistance(rects_[index], point);
+            if (distance < bestDistance || (distance == bestDistance && index < bestIndex)) {
+                bestDistance = distance;
+                bestIndex = index;
+            }
+        };
+
+        // Empty rectangles are not in any cell, so they are always checked directly.
+        for (int i = 0; i < static_cast<int>(rects_.size()); i++) {
+            if (rects_[i].empty()) {
+                checkRect(i);
+            }
+        }
+        if (cells_.empty()) {
+            return bestIndex;
+        }
+
+        // Search rings of cells around the point's cell, skipping the parts of each ring outside of
+        // the occupied cells. Every rectangle that has not been checked after finishing ring r is
+        // at least r * cellSize_ away.
+        int centerX = static_cast<int>(std::floor(point.x / cellSize_));
+        int centerY = static_cast<int>(std::floor(point.y / cellSize_));
+        int firstRing = std::max({ 0, minCell_.x - centerX, centerX - maxCell_.x,
+                                   minCell_.y - centerY, centerY - maxCell_.y });
+        int lastRing = std::max({ std::abs(centerX - minCell_.x), std::abs(centerX - maxCell_.x),
+                                  std::abs(centerY - minCell_.y), std::abs(centerY - maxCell_.y) });
+
+        auto checkCell = [&](int cellX, int cellY) {
+            auto cellIter = cells_.find(GetCellKey(cellX, cellY));
+            if (cellIter != cells_.end()) {
+                for (int index : cellIter->second) {
+                    checkRect(index);
+                }
+            }
+        };
+
+        for (int ring = firstRing; ring <= lastRing; ring++) {
+            int firstRow = std::max(centerY - ring, minCell_.y);
+            int lastRow = std::min(centerY + ring, maxCell_.y);
+            for (int cellY = firstRow; cellY <= lastRow; cellY++) {
+                if (cellY == centerY - ring || cellY == centerY + ring) {
+                    int firstColumn = std::max(centerX - ring, minCell_.x);
+                    int lastColumn = std::min(centerX + ring, maxCell_.x);
+                    for (int cellX = firstColumn; cellX <= lastColumn; cellX++) {
+                        checkCell(cellX, cellY);
+                    }
+                }
+                else {
+                    // Only the first and last columns of the middle rows are part of the ring.
+                    if (centerX - ring >= minCell_.x) {
+                        checkCell(centerX - ring, cellY);
+                    }
+                    if (centerX + ring <= maxCell_.x) {
+                        checkCell(centerX + ring, cellY);
+                    }
+                }
+            }
+            // An unchecked rectangle exactly ring * cellSize_ away could still win a tie with a
+            // lower index.
+            if (bestDistance < static_cast<double>(ring) * cellSize_) {
+                break;
+            }
+        }
+        return bestIndex;
+    }
+
+
+    int RectIndex::ToCell(int coordinate) const {
+        // Rounds toward negative infinity so that negative coordinates get their own cells.
+        return coordinate >= 0 ? coordinate / cellSize_ : -((-coordinate - 1) / cellSize_) - 1;
+    }
+
+
+    std::int64_t RectIndex::GetCellKey(int cellX, int cellY) {
+        return (static_cast<std::int64_t>(cellX) << 32) | static_cast<std::uint32_t>(cellY);
+    }
+
+
+    cv::Rect RectIndex::GetCellRange(const cv::Rect &rect) const {
+        if (rect.empty()) {
+            return {};
+        }
+        int firstX = ToCell(rect.x);
+        int firstY = ToCell(rect.y);
+        // The right and bottom edges are exclusive.
+        int lastX = ToCell(rect.x + rect.width - 1);
+        int lastY = ToCell(rect.y + rect.height - 1);
+        return { firstX, firstY, lastX - firstX + 1, lastY - firstY + 1 };
+    }
+}}
@@ -218,6 +218,21 @@ namespace MPF { namespace COMPONENT { namespace Utils {
     }
 
 
+    bool IsExistingRectIntersection(const cv::Rect &new_rect,
+                                    const RectIndex &existing_rects,
+                                    int &intersection_index) {
+        for (int index : existing_rects.QueryIntersecting(new_rect)) {
+            // An existing rect equal to new_rect is assumed to be new_rect itself.
+            if (existing_rects.Get(index) != new_rect) {
+                intersection_index = index;
+                return true;
+            }
+        }
+        intersection_index = -1;
+        return false;
+    }
+
+
     void DrawText(cv::Mat &image, int frame_index) {
         // assuming there won't be more than 10 chars in the frame_index
         string text = std::to_string(frame_index);
@@ -0,0 +1,123 @@
+/******************************************************************************
+ * NOTICE                                                                     *
+ *                                                                            *
+ * This software (or technical data) was produced for the U.S. Government     *
+ * under contract, and is subject to the Rights in Data-General Clause        *
+ * 52.227-14, Alt. IV (DEC 2007).                                             *
+ *                                                                            *
+ * Copyright 2024 The MITRE Corporation. All Rights Reserved.                 *
+ ******************************************************************************/
+
+/******************************************************************************
+ * Copyright 2024 The MITRE Corporation                                       *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License");            *
+ * you may not use this file except in compliance with the License.           *
+ * You may obtain a copy of the License at                                    *
+ *                                                                            *
+ *    http://www.apache.org/licenses/LICENSE-2.0                              *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <opencv2/core.hpp>
+
+#include <RectIndex.h>
+#include <Utils.h>
+
+
+using namespace MPF::COMPONENT;
+
+namespace {
+    std::vector<cv::Rect> CreateRandomRects(int count) {
+        cv::RNG rng(1234);
+        std::vector<cv::Rect> rects;
+        for (int i = 0; i < count; i++) {
+            rects.emplace_back(rng.uniform(-500, 2000), rng.uniform(-500, 2000),
+                               rng.uniform(0, 150), rng.uniform(0, 150));
+        }
+        return rects;
+    }
+
+    double GetDistance(const cv::Rect &rect, const cv::Point2d &point) {
+        double dx = std::max({ rect.x - point.x, 0.0, point.x - (rect.x + rect.width) });
+        double dy = std::max({ rect.y - point.y, 0.0, point.y - (rect.y + rect.height) });
+        return std::sqrt(dx * dx + dy * dy);
+    }
+}
+
+
+TEST(RectIndex, QueryIntersectingMatchesLinearScan) {
+    std::vector<cv::Rect> rects = CreateRandomRects(1000);
+    RectIndex index(rects);
+    ASSERT_EQ(rects.size(), index.Size());
+
+    for (const cv::Rect &query : CreateRandomRects(200)) {
+        std::vector<int> expected;
+        for (int i = 0; i < static_cast<int>(rects.size()); i++) {
+            if ((rects[i] & query).area() > 0) {
+                expected.push_back(i);
+            }
+        }
+        ASSERT_EQ(expected, index.QueryIntersecting(query));
+    }
+}
+
+
+TEST(RectIndex, QueryNearestMatchesLinearScan) {
+    std::vector<cv::Rect> rects = CreateRandomRects(1000);
+    RectIndex index(rects, 32);
+
+    cv::RNG rng(42);
+    for (int i = 0; i < 200; i++) {
+        cv::Point2d point(rng.uniform(-3000.0, 5000.0), rng.uniform(-3000.0, 5000.0));
+        int expected = -1;
+        double expectedDistance = std::numeric_limits<double>::max();
+        for (int j = 0; j < static_cast<int>(rects.size()); j++) {
+            double distance = GetDistance(rects[j], point);
+            if (distance < expectedDistance) {
+                expectedDistance = distance;
+                expected = j;
+            }
+        }
+        ASSERT_EQ(expected, index.QueryNearest(point));
+    }
+
+    ASSERT_EQ(-1, RectIndex().QueryNearest({ 0, 0 }));
+}
+
+
+TEST(RectIndex, QueryNearestBreaksTiesAcrossRings) {
+    RectIndex index(10);
+    // Both are 10 away from the point, but the lower index is one ring further out.
+    index.Insert({ -20, 0, 10, 10 });
+    index.Insert({ 10, 0, 10, 10 });
+    ASSERT_EQ(0, index.QueryNearest({ 0, 5 }));
+}
+
+
+TEST(RectIndex, IsExistingRectIntersectionIgnoresEqualRect) {
+    std::vector<cv::Rect> rects { { 0, 0, 10, 10 }, { 100, 100, 10, 10 }, { 5, 5, 10, 10 } };
+
+    int intersectionIndex = -2;
+    ASSERT_TRUE(Utils::IsExistingRectIntersection({ 0, 0, 10, 10 }, rects, intersectionIndex));
+    ASSERT_EQ(2, intersectionIndex);
+
+    ASSERT_FALSE(Utils::IsExistingRectIntersection({ 10, 0, 10, 5 }, rects, intersectionIndex));
+    ASSERT_EQ(-1, intersectionIndex);
+
+    RectIndex index(rects);
+    ASSERT_TRUE(Utils::IsExistingRectIntersection({ 95, 95, 10, 10 }, index, intersectionIndex));
+    ASSERT_EQ(1, intersectionIndex);
+}